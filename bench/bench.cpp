@@ -0,0 +1,229 @@
+// Benchmark for boolean_search with deterministic synthetic corpora
+//
+// usage: bench [--terms N] [--queries N] [--wildcards F] [--near F] [--size MB] [--seed N]
+
+#include "boolean_search.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+  struct Options {
+    size_t terms = 4;		// terms per query
+    size_t queries = 1;		// number of queries
+    double wildcards = 0.1;	// probability that a term has a wildcard
+    double near = 0.1;		// probability that an operator is NEAR
+    double size = 16;		// size of each corpus in MB
+    uint32_t seed = 1;
+  };
+
+  struct Corpus {
+    std::string name;
+    std::vector<std::string> documents;
+    size_t bytes = 0, characters = 0;
+  };
+
+  // A vocabulary of words made of the syllables of one or more scripts
+  class Vocabulary {
+  public:
+    Vocabulary(const std::vector<std::vector<std::string>> & scripts, size_t size, std::mt19937 & rng) {
+      std::uniform_int_distribution<size_t> length(1, 4);
+      for (size_t i = 0; i < size; i++) {
+	auto & syllables = scripts[i % scripts.size()];
+	std::uniform_int_distribution<size_t> syllable(0, syllables.size() - 1);
+	std::string word;
+	for (size_t n = length(rng); n > 0; n--) word += syllables[syllable(rng)];
+	words_.push_back(word);
+      }
+    }
+
+    // returns a word with a skewed frequency, so that some words are common
+    const std::string & get(std::mt19937 & rng) const {
+      std::uniform_real_distribution<double> u(0.0, 1.0);
+      auto i = static_cast<size_t>(static_cast<double>(words_.size()) * std::pow(u(rng), 3.0));
+      return words_[std::min(i, words_.size() - 1)];
+    }
+
+  private:
+    std::vector<std::string> words_;
+  };
+
+  const std::vector<std::string> latin = { "ka", "lo", "mi", "ne", "ru", "sa", "to", "vi", "an", "el", "or", "us", "pre", "con", "st" };
+  const std::vector<std::string> accented = { "é", "ü", "ñ", "ça", "lö", "rå", "ße", "ja" };
+  const std::vector<std::string> cyrillic = { "ка", "ло", "ми", "не", "ру", "са", "то", "ви" };
+  const std::vector<std::string> greek = { "κα", "λο", "μι", "νε", "ρυ", "σα", "το", "βι" };
+  const std::vector<std::string> cjk = { "中", "文", "字", "日", "本", "語", "東", "京" };
+
+  size_t countCharacters(const std::string & s) {
+    size_t n = 0;
+    for (auto c : s) {
+      if ((static_cast<unsigned char>(c) & 0xc0) != 0x80) n++;
+    }
+    return n;
+  }
+
+  // creates a corpus of about size bytes with documents of the given number of words
+  Corpus createCorpus(std::string name, const Vocabulary & vocabulary, size_t size, size_t min_words, size_t max_words, std::mt19937 & rng) {
+    Corpus corpus;
+    corpus.name = std::move(name);
+    std::uniform_int_distribution<size_t> words(min_words, max_words);
+    std::uniform_int_distribution<int> punctuation(0, 15);
+    while (corpus.bytes < size) {
+      std::string document;
+      for (size_t n = words(rng); n > 0; n--) {
+	auto & word = vocabulary.get(rng);
+	auto p = punctuation(rng);
+	if (!document.empty()) document += ' ';
+	if (p == 0 && !word.empty() && word[0] >= 'a' && word[0] <= 'z') {
+	  // capitalize some words
+	  document += static_cast<char>(word[0] - 'a' + 'A');
+	  document += word.substr(1);
+	} else {
+	  document += word;
+	}
+	if (p == 1) document += ',';
+	else if (p == 2) document += '.';
+      }
+      corpus.bytes += document.size();
+      corpus.characters += countCharacters(document);
+      corpus.documents.push_back(std::move(document));
+    }
+    return corpus;
+  }
+
+  // creates a random expression
+  std::string createQuery(const Options & options, const Vocabulary & ascii, const Vocabulary & mixed, std::mt19937 & rng) {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    auto createTerm = [&]() {
+      auto term = u(rng) < 0.8 ? ascii.get(rng) : mixed.get(rng);
+      if (u(rng) < options.wildcards && term.size() > 2) {
+	// keep complete codepoints
+	size_t n = term.size() / 2;
+	while (n > 0 && (static_cast<unsigned char>(term[n]) & 0xc0) == 0x80) n--;
+	term = term.substr(0, n) + "*";
+      }
+      return "\"" + term + "\"";
+    };
+
+    auto expression = createTerm();
+    for (size_t i = 1; i < options.terms; i++) {
+      auto r = u(rng);
+      std::string op;
+      if (r < options.near) op = "NEAR";
+      else if (r < options.near + (1.0 - options.near) * 0.6) op = "OR";
+      else if (r < options.near + (1.0 - options.near) * 0.9) op = "AND";
+      else op = "NOT";
+      expression = "(" + expression + ") " + op + " " + createTerm();
+    }
+    return expression;
+  }
+
+  double getSeconds(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  }
+
+  // matches the corpus repeatedly for at least a second and prints the throughput
+  void run(const Corpus & corpus, const boolean_matcher::compiled_query & query) {
+    boolean_matcher::scan_context context;
+    size_t matches = 0, passes = 0;
+    auto matchCorpus = [&]() {
+      for (auto & document : corpus.documents) {
+	if (query.size() == 1) matches += query.match(document, context) ? 1u : 0u;
+	else matches += query.match_all(document, context).size();
+      }
+    };
+
+    // warm up
+    matchCorpus();
+    matches = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    double seconds = 0;
+    do {
+      matchCorpus();
+      passes++;
+      seconds = getSeconds(t0);
+    } while (seconds < 1.0);
+
+    auto bytes = static_cast<double>(corpus.bytes * passes);
+    auto documents = static_cast<double>(corpus.documents.size() * passes);
+    auto characters = static_cast<double>(corpus.characters * passes);
+    std::cout << std::left << std::setw(8) << corpus.name << std::right
+	      << std::setw(10) << corpus.documents.size()
+	      << std::setw(10) << std::fixed << std::setprecision(1) << static_cast<double>(corpus.bytes) / 1e6
+	      << std::setw(12) << bytes / 1e6 / seconds
+	      << std::setw(14) << std::setprecision(0) << documents / seconds
+	      << std::setw(12) << std::setprecision(2) << seconds * 1e9 / characters
+	      << std::setw(12) << matches / passes
+	      << "\n";
+  }
+
+  void usage() {
+    std::cerr << "usage: bench [--terms N] [--queries N] [--wildcards F] [--near F] [--size MB] [--seed N]\n";
+    std::exit(1);
+  }
+}
+
+int main(int argc, char ** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 == argc) usage();
+    std::string name = argv[i];
+    const char * value = argv[++i];
+    if (name == "--terms") options.terms = std::max<size_t>(1, std::strtoul(value, nullptr, 10));
+    else if (name == "--queries") options.queries = std::max<size_t>(1, std::strtoul(value, nullptr, 10));
+    else if (name == "--wildcards") options.wildcards = std::atof(value);
+    else if (name == "--near") options.near = std::atof(value);
+    else if (name == "--size") options.size = std::atof(value);
+    else if (name == "--seed") options.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else usage();
+  }
+
+  std::mt19937 rng(options.seed);
+  Vocabulary ascii({ latin }, 5000, rng);
+  Vocabulary mixed({ latin, accented, cyrillic, greek, cjk }, 5000, rng);
+
+  auto size = static_cast<size_t>(options.size * 1e6);
+  std::vector<Corpus> corpora;
+  corpora.push_back(createCorpus("ascii", ascii, size, 100, 300, rng));
+  corpora.push_back(createCorpus("utf8", mixed, size, 100, 300, rng));
+  corpora.push_back(createCorpus("tweets", ascii, size, 5, 25, rng));
+  corpora.push_back(createCorpus("long", ascii, size, 10000, 20000, rng));
+
+  std::vector<std::string> expressions;
+  for (size_t i = 0; i < options.queries; i++) {
+    expressions.push_back(createQuery(options, ascii, mixed, rng));
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  boolean_matcher::compiled_query query(expressions);
+  auto build_time = getSeconds(t0);
+
+  std::cout << "queries: " << options.queries << ", terms: " << options.terms
+	    << ", wildcards: " << options.wildcards << ", near: " << options.near << "\n";
+  if (options.queries == 1) std::cout << "query: " << expressions.front() << "\n";
+  std::cout << "build: " << std::fixed << std::setprecision(2) << build_time * 1e3 << " ms, "
+	    << query.get_state_count() << " states, "
+	    << static_cast<double>(query.get_memory_usage()) / 1024.0 << " KiB\n\n";
+
+  std::cout << std::left << std::setw(8) << "corpus" << std::right
+	    << std::setw(10) << "docs"
+	    << std::setw(10) << "MB"
+	    << std::setw(12) << "MB/s"
+	    << std::setw(14) << "docs/s"
+	    << std::setw(12) << "ns/char"
+	    << std::setw(12) << "matches"
+	    << "\n";
+  for (auto & corpus : corpora) {
+    run(corpus, query);
+  }
+
+  return 0;
+}
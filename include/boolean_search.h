@@ -1,23 +1,60 @@
 #ifndef _BOOLEAN_MATCHER_H_
 #define _BOOLEAN_MATCHER_H_
 
-#include <codecvt>
-#include <locale>
 #include <string_view>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <array>
 #include <deque>
 #include <stdexcept>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <fstream>
+#include <cstring>
+#include <chrono>
+#include <variant>
+#include <cstdlib>
+#include <utility>
+#include <type_traits>
+#include <numeric>
+#include <limits>
 
 #include <utf8proc.h>
 
+#include "boolean_search_unicode.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BOOLEAN_MATCHER_USE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace boolean_matcher {
-  constexpr char32_t BOUNDARY = 0xe000;
+  // marks a word boundary in the patterns of the automaton. Control characters
+  // are stripped by normalization, so the byte never occurs in the text.
+  constexpr char BOUNDARY = '\x01';
 
-  // data for a single matching term
+  // data for a single matching term. The position and size are byte offsets
+  // into the normalized text during a scan, and into the searched text in the
+  // results of a search.
   struct match_data {
     match_data() : pos_(0), size_(0), word_index_(0) { }
     match_data(int pos, int size, int word_index) : pos_(pos), size_(size), word_index_(word_index) { }
@@ -25,41 +62,593 @@ namespace boolean_matcher {
     int pos_, size_, word_index_;
   };
 
-  // the main class
-  class matcher {
+  // Scan counters are updated only when the library is compiled with
+  // BOOLEAN_MATCHER_PROFILE, and otherwise compile away.
+#ifdef BOOLEAN_MATCHER_PROFILE
+  constexpr bool PROFILING = true;
+#else
+  constexpr bool PROFILING = false;
+#endif
+
+  // counters for the texts scanned with a scan_context. The times are in nanoseconds.
+  struct scan_statistics {
+    uint64_t texts_ = 0, bytes_ = 0, codepoints_ = 0, term_matches_ = 0;
+    // the bytes of normalized text that were skipped by the prefilter
+    uint64_t skipped_bytes_ = 0;
+    uint64_t normalize_ns_ = 0, scan_ns_ = 0, eval_ns_ = 0;
+  };
+
+  // counters of a result_cache
+  struct cache_statistics {
+    uint64_t hits_ = 0, misses_ = 0, evictions_ = 0;
+    size_t entries_ = 0, bytes_ = 0;
+
+    // returns the share of the lookups that were found in the cache
+    double get_hit_rate() const noexcept {
+      auto lookups = hits_ + misses_;
+      return lookups ? static_cast<double>(hits_) / static_cast<double>(lookups) : 0.0;
+    }
+  };
+
+  // the profile of a single node of an expression over a corpus
+  struct node_profile {
+    std::string expression_;
+    size_t depth_ = 0;
+    // the number of texts, the texts where the node is true and the total size of its match lists
+    uint64_t evaluations_ = 0, hits_ = 0, matches_ = 0;
+    uint64_t eval_ns_ = 0;
+  };
+
+  // the class of a codepoint for word segmentation. A word boundary is between
+  // codepoints of different classes and around each SINGLE codepoint.
+  enum class word_class : uint8_t { NON_WORD, WORD, SINGLE };
+
+  // returns true if codepoint is a letter, a decimal digit or connector punctuation
+  constexpr bool is_word_character(char32_t codepoint) noexcept {
+    if (codepoint >= 0x110000) return false;
+    auto & words = unicode::WORD_BLOCKS[unicode::WORD_BLOCK_INDEX[codepoint >> 8]];
+    return (words[(codepoint >> 6) & 3] >> (codepoint & 63)) & 1;
+  }
+
+  // The default tokenizer, where words are runs of word characters. A tokenizer
+  // is a template parameter of the matchers, and its ID is stored in saved
+  // queries. ASCII must be classified as by the default tokenizer.
+  struct word_tokenizer {
+    static constexpr uint32_t ID = 0;
+
+    static constexpr word_class get_class(char32_t codepoint) noexcept {
+      return is_word_character(codepoint) ? word_class::WORD : word_class::NON_WORD;
+    }
+  };
+
+  // A tokenizer for text without spaces between words. As in the default rules of
+  // UAX #29, each ideograph and hiragana character is a word of its own, so that
+  // terms can be found inside runs of Chinese or Japanese text.
+  struct cjk_tokenizer {
+    static constexpr uint32_t ID = 1;
+
+    static constexpr word_class get_class(char32_t codepoint) noexcept {
+      if (!is_word_character(codepoint)) return word_class::NON_WORD;
+      if ((codepoint >= 0x3040 && codepoint < 0x30a0) || // Hiragana
+	  (codepoint >= 0x3400 && codepoint < 0x4dc0) || // CJK Unified Ideographs Extension A
+	  (codepoint >= 0x4e00 && codepoint < 0xa000) || // CJK Unified Ideographs
+	  (codepoint >= 0xf900 && codepoint < 0xfb00) || // CJK Compatibility Ideographs
+	  (codepoint >= 0x20000 && codepoint < 0x40000)) { // Supplementary and Tertiary Ideographic Planes
+	return word_class::SINGLE;
+      }
+      return word_class::WORD;
+    }
+  };
+
+  // the value of a metadata field, which is a number or a string
+  using metadata_value = std::variant<double, std::string>;
+
+  // A per-document record of metadata fields for predicates such as
+  // .timestamp > "2024-10-01". Records are small, so the fields are kept in a
+  // vector that is searched linearly.
+  class metadata {
+  public:
+    metadata() { }
+    metadata(std::initializer_list<std::pair<std::string, metadata_value>> fields) {
+      for (auto & [ key, value ] : fields) set(key, value);
+    }
+
+    // sets a field, replacing its previous value
+    void set(std::string_view key, metadata_value value) {
+      for (auto & field : fields_) {
+	if (field.first == key) {
+	  field.second = std::move(value);
+	  return;
+	}
+      }
+      fields_.emplace_back(std::string(key), std::move(value));
+    }
+
+    // returns the value of a field, or nullptr if the record does not have it
+    const metadata_value * get(std::string_view key) const noexcept {
+      for (auto & field : fields_) {
+	if (field.first == key) return &field.second;
+      }
+      return nullptr;
+    }
+
+    void clear() noexcept { fields_.clear(); }
+
+  private:
+    std::vector<std::pair<std::string, metadata_value>> fields_;
+  };
+
+  template<typename Tokenizer> class basic_compiled_query;
+  template<typename Tokenizer> class basic_document_index;
+
+  // A bounded cache of the results of texts for streams with duplicate texts. The
+  // results are keyed by two 64-bit hashes and the size of the text, and by the id
+  // of the compiled query, which changes when the query is optimized, so results
+  // of other queries are never returned. The cache is split into shards with
+  // their own locks, and each shard evicts entries with the CLOCK algorithm
+  // when it exceeds its share of the memory budget. A cache can be shared by
+  // threads and queries.
+  class result_cache {
+  public:
+    explicit result_cache(size_t memory_budget = 64 << 20, size_t shard_count = 16)
+      : shards_(std::max<size_t>(shard_count, 1)),
+	shard_budget_(memory_budget / std::max<size_t>(shard_count, 1)) { }
+
+    result_cache(const result_cache &) = delete;
+    result_cache & operator=(const result_cache &) = delete;
+
+    // returns the counters of the cache
+    cache_statistics get_statistics() const {
+      cache_statistics r;
+      r.hits_ = hits_.load(std::memory_order_relaxed);
+      r.misses_ = misses_.load(std::memory_order_relaxed);
+      r.evictions_ = evictions_.load(std::memory_order_relaxed);
+      for (auto & shard : shards_) {
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	r.entries_ += shard.entries.size();
+	r.bytes_ += shard.bytes;
+      }
+      return r;
+    }
+
+    // removes all entries
+    void clear() {
+      for (auto & shard : shards_) {
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	shard.index.clear();
+	shard.entries.clear();
+	shard.hand = shard.bytes = 0;
+      }
+    }
+
+  private:
+    template<typename> friend class basic_compiled_query;
+
+    // The key of a text. The hash selects the shard and the entry, and the check
+    // hash, which is mixed independently, makes a false hit practically impossible
+    // without keeping a copy of the text.
+    struct Key {
+      uint64_t hash, check;
+      size_t size;
+      bool operator==(const Key & other) const noexcept { return hash == other.hash && check == other.check && size == other.size; }
+    };
+
+    // The results of a text: the outcome of match() and the matches of search().
+    // A search also stores the outcome, while a match stores only the outcome.
+    struct Entry {
+      Key key;
+      uint64_t query;
+      bool has_match = false, is_match = false, has_matches = false, is_referenced = true;
+      std::vector<match_data> matches;
+
+      // returns the approximate memory usage of the entry and its index node
+      size_t getBytes() const noexcept { return sizeof(Entry) + 4 * sizeof(void *) + matches.size() * sizeof(match_data); }
+    };
+
+    struct Shard {
+      mutable std::mutex mutex;
+      std::unordered_map<uint64_t, size_t> index;
+      std::vector<Entry> entries;
+      size_t hand = 0, bytes = 0;
+    };
+
+    // returns a new id for a compiled query
+    static uint64_t getQueryId() noexcept {
+      static std::atomic<uint64_t> next_id(1);
+      return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // A fast non-cryptographic key of a text that reads 8 bytes at a time. The
+    // mixing functions are the finalizers of SplitMix64 and MurmurHash3.
+    static Key hashText(std::string_view text) noexcept {
+      auto mix = [](uint64_t x) {
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+      };
+      auto mix2 = [](uint64_t x) {
+	x = (x ^ (x >> 33)) * 0xff51afd7ed558ccdULL;
+	x = (x ^ (x >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+	return x ^ (x >> 33);
+      };
+      uint64_t h = 0x9e3779b97f4a7c15ULL ^ text.size(), h2 = 0x6a09e667f3bcc909ULL ^ text.size();
+      size_t i = 0;
+      for (; i + 8 <= text.size(); i += 8) {
+	uint64_t v;
+	std::memcpy(&v, text.data() + i, 8);
+	h = mix(h ^ v);
+	h2 = mix2(h2 + v);
+      }
+      uint64_t v = 0;
+      if (i < text.size()) std::memcpy(&v, text.data() + i, text.size() - i);
+      return Key{ mix(h ^ v), mix2(h2 + v), text.size() };
+    }
+
+    // looks up the outcome of match() for a text
+    bool findMatch(const Key & key, uint64_t query, bool & is_match) {
+      auto & shard = getShard(key.hash);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto entry = find(shard, key, query);
+      if (!entry || !entry->has_match) return countLookup(false);
+      is_match = entry->is_match;
+      return countLookup(true);
+    }
+
+    // looks up the matches of search() for a text
+    bool findMatches(const Key & key, uint64_t query, std::vector<match_data> & matches, bool & is_match) {
+      auto & shard = getShard(key.hash);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto entry = find(shard, key, query);
+      if (!entry || !entry->has_matches) return countLookup(false);
+      matches = entry->matches;
+      is_match = entry->is_match;
+      return countLookup(true);
+    }
+
+    void storeMatch(const Key & key, uint64_t query, bool is_match) {
+      store(key, query, [&](Entry & entry) {
+	entry.has_match = true;
+	entry.is_match = is_match;
+      });
+    }
+
+    void storeMatches(const Key & key, uint64_t query, const std::vector<match_data> & matches, bool is_match) {
+      store(key, query, [&](Entry & entry) {
+	entry.has_match = entry.has_matches = true;
+	entry.is_match = is_match;
+	entry.matches = matches;
+      });
+    }
+
+    Shard & getShard(uint64_t hash) noexcept { return shards_[(hash >> 32) % shards_.size()]; }
+
+    // returns the index key of the results of a text for a query, so that queries
+    // that share a cache have their own entries for the same text
+    static uint64_t getSlot(const Key & key, uint64_t query) noexcept { return key.hash ^ (query * 0x9e3779b97f4a7c15ULL); }
+
+    bool countLookup(bool is_hit) noexcept {
+      (is_hit ? hits_ : misses_).fetch_add(1, std::memory_order_relaxed);
+      return is_hit;
+    }
+
+    // returns the entry of a text, or nullptr if the shard does not have one
+    static Entry * find(Shard & shard, const Key & key, uint64_t query) noexcept {
+      auto it = shard.index.find(getSlot(key, query));
+      if (it == shard.index.end()) return nullptr;
+      auto & entry = shard.entries[it->second];
+      if (!(entry.key == key) || entry.query != query) return nullptr;
+      entry.is_referenced = true;
+      return &entry;
+    }
+
+    // updates the entry of a text and a query, replacing an entry with the same
+    // index key, and evicts entries until the shard fits its budget
+    template<typename F>
+    void store(const Key & key, uint64_t query, F && update) {
+      auto & shard = getShard(key.hash);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto [ it, is_new ] = shard.index.emplace(getSlot(key, query), shard.entries.size());
+      if (is_new) shard.entries.push_back(Entry{ key, query });
+      auto & entry = shard.entries[it->second];
+      shard.bytes -= is_new ? 0 : entry.getBytes();
+      if (!(entry.key == key) || entry.query != query) entry = Entry{ key, query };
+      update(entry);
+      entry.is_referenced = true;
+      shard.bytes += entry.getBytes();
+
+      // the hand clears the reference bits until it finds an entry that has not
+      // been used since its last pass
+      while (shard.bytes > shard_budget_ && !shard.entries.empty()) {
+	if (shard.hand >= shard.entries.size()) shard.hand = 0;
+	auto & victim = shard.entries[shard.hand];
+	if (victim.is_referenced) {
+	  victim.is_referenced = false;
+	  shard.hand++;
+	  continue;
+	}
+	shard.bytes -= victim.getBytes();
+	shard.index.erase(getSlot(victim.key, victim.query));
+	// the last entry fills the hole and is looked at next
+	if (shard.hand + 1 < shard.entries.size()) {
+	  victim = std::move(shard.entries.back());
+	  shard.index[getSlot(victim.key, victim.query)] = shard.hand;
+	}
+	shard.entries.pop_back();
+	evictions_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    std::vector<Shard> shards_;
+    size_t shard_budget_;
+    std::atomic<uint64_t> hits_{0}, misses_{0}, evictions_{0};
+  };
+
+  // The mutable state for scanning texts with a compiled_query. A context is
+  // cheap to create, and each thread should use its own context.
+  class scan_context {
+  public:
+    scan_context() { }
+
+    // returns the counters of the scans, which are zero unless profiling is enabled
+    const scan_statistics & get_statistics() const noexcept { return statistics_; }
+    void reset_statistics() noexcept { statistics_ = scan_statistics(); }
+
+  private:
+    template<typename Tokenizer> friend class basic_compiled_query;
+    template<typename Tokenizer> friend class basic_document_index;
+
+    uint32_t current_state_ = 0;
+    int current_pos_ = 0, current_word_ = 0;
+    word_class prev_class_ = word_class::NON_WORD;
+    // the scan stops when the outcome of the first expression is decided
+    bool stop_early_ = false, is_decided_ = false;
+    // the number of matches and the count at which a positional expression is
+    // next evaluated, which doubles so that the evaluations take linear time
+    size_t match_count_ = 0, next_check_ = 1;
+    // the metadata record of the text, or nullptr if it has none
+    const metadata * metadata_ = nullptr;
+    // Maps positions in the normalized text to byte offsets in the input. Each
+    // segment starts at a position of the normalized text. Positions in an exact
+    // segment map one to one, and other segments are mapped as a whole.
+    struct Offset {
+      int normalized, original;
+      bool is_exact;
+    };
+    std::vector<Offset> offsets_;
+    // the matches of each term, the terms that have matches and a bitset of them
+    std::vector<std::vector<match_data>> matches_;
+    std::vector<uint32_t> matched_terms_;
+    std::vector<uint64_t> term_hits_;
+    // the expressions that have term matches
+    std::vector<uint32_t> hits_;
+    std::vector<bool> is_hit_;
+    // the partial matches of wildcard terms ending at each fragment, and the
+    // fragments that have one
+    struct Chain {
+      int start = -1, end = 0, word = 0;
+    };
+    std::vector<Chain> chains_;
+    std::vector<uint32_t> chained_fragments_;
+    // The term matches of a chunk of a text that is scanned in parallel with
+    // other chunks, or nullptr. The matches are recorded without joining the
+    // fragments, and they are added in the order of the text after the scan.
+    struct ChunkMatch {
+      uint32_t term, query;
+      int pos, word;
+    };
+    std::vector<ChunkMatch> * chunk_matches_ = nullptr;
+    // normalized text and a buffer for utf8proc, reused between texts
+    std::string text_;
+    std::vector<utf8proc_int32_t> buffer_;
+    // the end of the previous chunk that has not been normalized yet
+    std::string pending_;
+    // a UTF-16 or UTF-32 text converted to UTF-8, reused between texts
+    std::string input_;
+    scan_statistics statistics_;
+  };
+
+  // A pool of threads for matching batches of texts. Each worker owns a deque of
+  // chunks of the batch and steals chunks from the other workers when its own
+  // deque is empty, so that uneven text sizes do not leave threads idle. Each
+  // worker also has a scan_context whose buffers are reused between texts.
+  class thread_pool {
+  public:
+    explicit thread_pool(size_t thread_count = std::thread::hardware_concurrency()) {
+      if (!thread_count) thread_count = 1;
+      for (size_t i = 0; i < thread_count; i++) {
+	workers_.push_back(std::make_unique<Worker>());
+      }
+      // the calling thread acts as the first worker
+      for (size_t i = 1; i < thread_count; i++) {
+	threads_.emplace_back([this, i]() { run(i); });
+      }
+    }
+
+    ~thread_pool() {
+      {
+	std::lock_guard<std::mutex> lock(mutex_);
+	is_stopped_ = true;
+      }
+      start_cv_.notify_all();
+      for (auto & thread : threads_) thread.join();
+    }
+
+    thread_pool(const thread_pool &) = delete;
+    thread_pool & operator=(const thread_pool &) = delete;
+
+    // returns the number of workers
+    size_t size() const noexcept { return workers_.size(); }
+
+    // Calls fn(index, context) for each index in [0, n) and waits for the calls to
+    // finish. A call from a task of the same pool runs the loop inline on the
+    // calling thread with a context of its own, since the workers are busy.
+    template<typename F>
+    void for_each(size_t n, F && fn) {
+      if (!n) return;
+      if (getCurrentPool() == this) {
+	scan_context context;
+	for (size_t i = 0; i < n; i++) fn(i, context);
+	return;
+      }
+      std::lock_guard<std::mutex> batch_lock(batch_mutex_);
+
+      task_ = [&fn](size_t begin, size_t end, scan_context & context) {
+	for (auto i = begin; i < end; i++) fn(i, context);
+      };
+      error_ = nullptr;
+
+      // deal contiguous runs of small chunks to the workers
+      auto worker_count = workers_.size();
+      auto chunk_size = std::max<size_t>(1, std::min<size_t>(64, n / (worker_count * 8)));
+      auto chunk_count = (n + chunk_size - 1) / chunk_size;
+      remaining_ = chunk_count;
+      for (size_t i = 0; i < worker_count; i++) {
+	auto & worker = *workers_[i];
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	for (auto chunk = chunk_count * i / worker_count; chunk < chunk_count * (i + 1) / worker_count; chunk++) {
+	  worker.chunks.emplace_back(chunk * chunk_size, std::min(n, (chunk + 1) * chunk_size));
+	}
+      }
+      {
+	std::lock_guard<std::mutex> lock(mutex_);
+	generation_++;
+      }
+      start_cv_.notify_all();
+
+      work(0);
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_cv_.wait(lock, [this]() { return remaining_ == 0; });
+      task_ = nullptr;
+      if (error_) std::rethrow_exception(error_);
+    }
+
+  private:
+    struct Worker {
+      std::mutex mutex;
+      std::deque<std::pair<size_t, size_t>> chunks;
+      scan_context context;
+    };
+
+    void run(size_t i) {
+      size_t generation = 0;
+      while (true) {
+	{
+	  std::unique_lock<std::mutex> lock(mutex_);
+	  start_cv_.wait(lock, [&]() { return is_stopped_ || generation_ != generation; });
+	  if (is_stopped_) return;
+	  generation = generation_;
+	}
+	work(i);
+      }
+    }
+
+    // returns the pool whose task the calling thread is running, or nullptr
+    static const thread_pool *& getCurrentPool() noexcept {
+      static thread_local const thread_pool * pool = nullptr;
+      return pool;
+    }
+
+    // processes the chunks of worker i and then steals from the others
+    void work(size_t i) {
+      std::pair<size_t, size_t> chunk;
+      while (popChunk(i, chunk) || stealChunk(i, chunk)) {
+	auto & current_pool = getCurrentPool();
+	auto prev_pool = current_pool;
+	current_pool = this;
+	try {
+	  task_(chunk.first, chunk.second, workers_[i]->context);
+	} catch (...) {
+	  std::lock_guard<std::mutex> lock(mutex_);
+	  if (!error_) error_ = std::current_exception();
+	}
+	current_pool = prev_pool;
+	if (--remaining_ == 0) {
+	  std::lock_guard<std::mutex> lock(mutex_);
+	  done_cv_.notify_all();
+	}
+      }
+    }
+
+    // takes a chunk from the back of the own deque
+    bool popChunk(size_t i, std::pair<size_t, size_t> & chunk) {
+      auto & worker = *workers_[i];
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      if (worker.chunks.empty()) return false;
+      chunk = worker.chunks.back();
+      worker.chunks.pop_back();
+      return true;
+    }
+
+    // takes a chunk from the front of the deque of another worker
+    bool stealChunk(size_t i, std::pair<size_t, size_t> & chunk) {
+      for (size_t k = 1; k < workers_.size(); k++) {
+	auto & victim = *workers_[(i + k) % workers_.size()];
+	std::lock_guard<std::mutex> lock(victim.mutex);
+	if (!victim.chunks.empty()) {
+	  chunk = victim.chunks.front();
+	  victim.chunks.pop_front();
+	  return true;
+	}
+      }
+      return false;
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::function<void(size_t, size_t, scan_context &)> task_;
+    std::exception_ptr error_;
+    std::atomic<size_t> remaining_{ 0 };
+    size_t generation_ = 0;
+    bool is_stopped_ = false;
+    std::mutex mutex_, batch_mutex_;
+    std::condition_variable start_cv_, done_cv_;
+  };
+
+  // An immutable query compiled from one or more expressions. The automaton and
+  // the expression trees are shared, so a compiled query can be used from
+  // several threads at the same time as long as each has its own scan_context.
+  // The Tokenizer splits the text and the terms into words.
+  template<typename Tokenizer = word_tokenizer>
+  class basic_compiled_query {
   public:
 
-    // result of a search
+    // Result of a search. The matches are byte offsets into the searched text,
+    // which the result refers to without copying it, so the text must outlive
+    // the result. The hit sentence is built on request.
     class result {
     public:
-      explicit result(std::u32string input) noexcept : input_(std::move(input)) { }
-      explicit result(std::u32string input, std::vector<match_data> matches) noexcept : input_(std::move(input)), matches_(std::move(matches)) { }
+      result() noexcept { }
+      explicit result(std::string_view input) noexcept : input_(input) { }
+      // the outcome of an expression that matches without term matches, such as a predicate
+      explicit result(std::string_view input, bool is_match) noexcept : input_(input), is_match_(is_match) { }
+      explicit result(std::string_view input, std::vector<match_data> matches) noexcept : input_(input), matches_(std::move(matches)), is_match_(!matches_.empty()) { }
       
-      bool has_match() const noexcept { return !matches_.empty(); }
+      bool has_match() const noexcept { return is_match_; }
+
+      // returns the matches as byte offsets into the text
+      const std::vector<match_data> & get_matches() const noexcept { return matches_; }
       
       std::string get_hit_sentence() const noexcept {
 	if (!matches_.empty()) {
 	  auto & match0 = matches_.front();
-	  auto i0 = match0.pos_;
-	  auto i1 = i0 + match0.size_;
+	  auto i0 = static_cast<size_t>(match0.pos_);
+	  auto i1 = i0 + static_cast<size_t>(match0.size_);
+	  // two words on both sides, where runs of white space separate the words
 	  for (int k = 0; k < 2; k++) {
 	    if (i0 > 0) {
-	      auto pos = input_.rfind(' ', i0 - 1);
-	      if (pos != std::string::npos) i0 = pos;
-	      else i0 = 0;
+	      auto pos = input_.find_last_not_of(SPACES, i0 - 1);
+	      i0 = pos != std::string::npos ? input_.find_last_of(SPACES, pos) + 1 : 0;
 	    } 
-	    if (i1 < static_cast<int>(input_.size())) {
-	      auto pos = input_.find(' ', i1 + 1);
-	      if (pos != std::string::npos) i1 = pos;
-	      else i1 = input_.size();
+	    if (i1 < input_.size()) {
+	      auto pos = input_.find_first_not_of(SPACES, i1);
+	      i1 = pos != std::string::npos ? std::min(input_.find_first_of(SPACES, pos), input_.size()) : input_.size();
 	    }
 	  }
-	  auto s = input_.substr(i0, i1 - i0);
-	  std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> converter;
-	  auto hit_sentence = converter.to_bytes(s.data(), s.data() + s.size());
+	  auto hit_sentence = std::string(input_.substr(i0, i1 - i0));
 	  
 	  if (i0 > 0) hit_sentence = "… " + hit_sentence;
-	  if (i1 < static_cast<int>(input_.size())) hit_sentence += " …";
+	  if (i1 < input_.size()) hit_sentence += " …";
 	  
 	  return hit_sentence;
 	} else {
@@ -68,559 +657,3905 @@ namespace boolean_matcher {
       }
       
     private:
-      std::u32string input_;
+      static constexpr const char * SPACES = " \t\n\v\f\r";
+
+      std::string_view input_;
       std::vector<match_data> matches_;
+      bool is_match_ = false;
     };
     
-    explicit matcher(std::string_view expression)
-      : expression_(parse(expression)) { }
+    explicit basic_compiled_query(std::string_view expression) {
+      expressions_.push_back(parse(expression));
+      compile();
+    }
 
-    // returns true if the matcher matches text
-    bool match(std::string_view text) {
-      initialize();
-      auto text1 = normalize(text);
-      auto text2 = converter_.from_bytes(text1.data(), text1.data() + text1.size());
-      updateState(text2);
-      return expression_->eval();
+    explicit basic_compiled_query(const std::vector<std::string> & expressions) {
+      for (auto & expression : expressions) {
+	expressions_.push_back(parse(expression));
+      }
+      compile();
     }
 
-    // returns extended search results for a text
-    result search(std::string_view text) {
-      initialize();
-      auto text1 = normalize(text);
-      auto text2 = converter_.from_bytes(text1.data(), text1.data() + text1.size());
-      updateState(text2);
-      return result(text2, expression_->getMatches());
+    // returns the number of expressions
+    size_t size() const noexcept { return expressions_.size(); }
+
+    // returns the number of states in the automaton
+    size_t get_state_count() const noexcept { return automaton_.getStateCount(); }
+
+    // returns the approximate number of bytes used by the automaton and the programs
+    size_t get_memory_usage() const noexcept {
+      size_t r = automaton_.getMemoryUsage() + term_sizes_.capacity() * sizeof(int);
+      r += fragment_ids_.capacity() * sizeof(uint32_t) + fragments_.capacity() * sizeof(Fragment);
+      for (auto & program : programs_) {
+	r += sizeof(Program) + program.code.capacity() * sizeof(Instruction) + program.nodes.capacity() * sizeof(const Node *);
+      }
+      return r;
     }
 
-  private:
-    // returns true if codepoint is a word character
-    static bool isWordCharacter(char32_t codepoint) noexcept {
-      auto cat = utf8proc_category(static_cast<utf8proc_int32_t>(codepoint));
-      return cat == UTF8PROC_CATEGORY_LU || cat == UTF8PROC_CATEGORY_LL || cat == UTF8PROC_CATEGORY_LT || cat == UTF8PROC_CATEGORY_LM || cat == UTF8PROC_CATEGORY_LO || cat == UTF8PROC_CATEGORY_ND || cat == UTF8PROC_CATEGORY_PC;
+    // Writes the compiled query to a file that can be loaded with load(). The
+    // format is tied to the version of the library and to the byte order.
+    void save(const std::string & filename) const {
+      FileHeader header;
+      std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+      std::string data(sizeof(FileHeader), '\0');
+
+      // the expression trees are stored as postfix records
+      header.expression_count = expressions_.size();
+      header.expressions_offset = data.size();
+      for (auto & expression : expressions_) {
+	std::string records;
+	expression->write(records);
+	appendValue(data, static_cast<uint32_t>(records.size()));
+	data += records;
+      }
+      header.expressions_size = data.size() - header.expressions_offset;
+      header.term_count = term_sizes_.size();
+      automaton_.write(header, data);
+      std::memcpy(&data[0], &header, sizeof(header));
+
+      std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+      out.write(data.data(), static_cast<std::streamsize>(data.size()));
+      if (!out) throw std::runtime_error("cannot write " + filename);
     }
 
-    // A node for the binary expression tree
-    class Node {
-    public:
-      Node() { }
-      Node(std::vector<std::unique_ptr<Node> > & node_stack) {
-	if (node_stack.size() < 2) throw std::runtime_error("stack underflow");
+    // Loads a query written by save(). The automaton is mapped read-only, so
+    // processes that load the same file share its pages, and the load time does
+    // not depend on the size of the automaton. The file is assumed to be trusted.
+    static std::shared_ptr<const basic_compiled_query> load(const std::string & filename) {
+      return std::shared_ptr<const basic_compiled_query>(new basic_compiled_query(std::make_shared<const MappedFile>(filename)));
+    }
 
-	right_ = std::move(node_stack.back());
-	node_stack.pop_back();
-	left_ = std::move(node_stack.back());
-	node_stack.pop_back();
+    // returns true if the first expression matches text. The scan stops as soon
+    // as further matches can no longer change the outcome.
+    bool match(std::string_view text, scan_context & context) const {
+      return match(text, nullptr, context);
+    }
+
+    // Returns true if the first expression matches a text with a metadata record.
+    // The predicates are evaluated first, and the text is not normalized or
+    // scanned if they decide the outcome.
+    bool match(std::string_view text, const metadata & record, scan_context & context) const {
+      return match(text, &record, context);
+    }
+
+    // returns the ids of the expressions that match text in ascending order
+    std::vector<size_t> match_all(std::string_view text, scan_context & context) const {
+      return match_all(text, nullptr, context);
+    }
+
+    // returns the ids of the expressions that match a text with a metadata record.
+    // The text is not scanned if the predicates decide every expression.
+    std::vector<size_t> match_all(std::string_view text, const metadata & record, scan_context & context) const {
+      return match_all(text, &record, context);
+    }
+
+    // returns extended search results of the first expression for a text
+    result search(std::string_view text, scan_context & context) const {
+      return search(text, nullptr, context);
+    }
+
+    // returns extended search results for a text with a metadata record. The text
+    // is not scanned if the predicates rule out a match.
+    result search(std::string_view text, const metadata & record, scan_context & context) const {
+      return search(text, &record, context);
+    }
+
+    // Returns true if the first expression matches text. The outcome is looked up
+    // in a cache by the hash of the text first, and it is stored there after a
+    // scan, so that duplicate texts are not normalized or scanned again.
+    bool match(std::string_view text, scan_context & context, result_cache & cache) const {
+      auto key = result_cache::hashText(text);
+      bool is_match;
+      if (cache.findMatch(key, id_, is_match)) return is_match;
+      is_match = match(text, context);
+      cache.storeMatch(key, id_, is_match);
+      return is_match;
+    }
+
+    // returns extended search results for a text, which are looked up in a cache first
+    result search(std::string_view text, scan_context & context, result_cache & cache) const {
+      auto key = result_cache::hashText(text);
+      std::vector<match_data> matches;
+      bool is_match = false;
+      if (cache.findMatches(key, id_, matches, is_match)) return matches.empty() ? result(text, is_match) : result(text, std::move(matches));
+      auto r = search(text, context);
+      cache.storeMatches(key, id_, r.get_matches(), r.has_match());
+      return r;
+    }
+
+    // Returns true if the first expression matches a UTF-16 or UTF-32 text. The
+    // text is converted to UTF-8 in a buffer of the context and then normalized.
+    // Unpaired surrogates are replaced with U+FFFD.
+    bool match(std::u16string_view text, scan_context & context) const {
+      return match(toUtf8(text, context), nullptr, context);
+    }
+
+    bool match(std::u32string_view text, scan_context & context) const {
+      return match(toUtf8(text, context), nullptr, context);
+    }
+
+    // a wide string is UTF-16 or UTF-32 depending on the size of wchar_t
+    bool match(std::wstring_view text, scan_context & context) const {
+      return match(toUtf8(text, context), nullptr, context);
+    }
+
+    // Returns true if the first expression matches a text that is already in the
+    // normalized form: NFC, case folded, without control characters, and with
+    // line breaks and tabs replaced by spaces. The text is scanned in place
+    // without normalization or allocation.
+    bool match_normalized(std::string_view text, scan_context & context) const {
+      return matchNormalized(text, context);
+    }
+
+    // returns true if the first expression matches a normalized UTF-16 or UTF-32
+    // text, which is scanned in place and encoded as UTF-8 one codepoint at a time
+    bool match_normalized(std::u16string_view text, scan_context & context) const {
+      return matchNormalized(text, context);
+    }
+
+    bool match_normalized(std::u32string_view text, scan_context & context) const {
+      return matchNormalized(text, context);
+    }
+
+    bool match_normalized(std::wstring_view text, scan_context & context) const {
+      return matchNormalized(text, context);
+    }
+
+    // returns extended search results for a normalized text, where the match
+    // offsets are the same as in the normalized text
+    result search_normalized(std::string_view text, scan_context & context) const {
+      start(context, nullptr);
+      if (decide(0, context) == Outcome::NO_MATCH) return result(text);
+      {
+	Stopwatch stopwatch(context.statistics_.scan_ns_);
+	if constexpr (PROFILING) context.statistics_.bytes_ += text.size();
+	updateState(text, context);
+	finishState(context);
       }
-      
-      virtual ~Node() { }
+      Stopwatch stopwatch(context.statistics_.eval_ns_);
+      if (expressions_.empty()) return result(text);
+      auto matches = expressions_.front()->getMatches(context);
+      if (matches.empty()) return result(text, eval(context));
+      return result(text, std::move(matches));
+    }
 
-      virtual bool eval() const = 0;
-      virtual std::vector<match_data> getMatches() const = 0;
-      virtual void serialize(std::string & r) const = 0;
-      virtual void addMatch(int pos, int word_index) { }
+    // matches a batch of texts in parallel and returns a bitmap of the results
+    template<typename Texts>
+    std::vector<bool> match_batch(const Texts & texts, thread_pool & pool) const {
+      std::vector<char> r(texts.size());
+      pool.for_each(texts.size(), [&](size_t i, scan_context & context) {
+	r[i] = match(texts[i], context);
+      });
+      return std::vector<bool>(r.begin(), r.end());
+    }
+
+    // matches a batch of texts with their metadata records in parallel
+    template<typename Texts, typename Records>
+    std::vector<bool> match_batch(const Texts & texts, const Records & records, thread_pool & pool) const {
+      if (records.size() != texts.size()) throw std::runtime_error("the number of records does not match the number of texts");
+      std::vector<char> r(texts.size());
+      pool.for_each(texts.size(), [&](size_t i, scan_context & context) {
+	r[i] = match(texts[i], records[i], context);
+      });
+      return std::vector<bool>(r.begin(), r.end());
+    }
+
+    // searches a batch of texts in parallel and returns the results in the same order
+    template<typename Texts>
+    std::vector<result> search_batch(const Texts & texts, thread_pool & pool) const {
+      std::vector<result> r(texts.size());
+      pool.for_each(texts.size(), [&](size_t i, scan_context & context) {
+	r[i] = search(texts[i], context);
+      });
+      return r;
+    }
+
+    // matches a batch of texts in parallel and looks the results up in a cache first
+    template<typename Texts>
+    std::vector<bool> match_batch(const Texts & texts, thread_pool & pool, result_cache & cache) const {
+      std::vector<char> r(texts.size());
+      pool.for_each(texts.size(), [&](size_t i, scan_context & context) {
+	r[i] = match(texts[i], context, cache);
+      });
+      return std::vector<bool>(r.begin(), r.end());
+    }
+
+    // Returns true if the first expression matches a large text, which is split
+    // into chunks of about chunk_size bytes that are normalized and scanned in
+    // parallel. The result is the same as with match(), but the scan does not
+    // stop early. A text that fits in a single chunk is matched with match().
+    bool match(std::string_view text, scan_context & context, thread_pool & pool, size_t chunk_size = PARALLEL_CHUNK_SIZE) const {
+      if (text.size() <= chunk_size) return match(text, context);
+      start(context, nullptr);
+      auto outcome = decide(0, context);
+      if (outcome != Outcome::UNDECIDED) return outcome == Outcome::MATCH;
+      scanParallel(text, context, pool, chunk_size, nullptr);
+      Stopwatch stopwatch(context.statistics_.eval_ns_);
+      return eval(context);
+    }
+
+    // returns extended search results for a large text, which is scanned in
+    // parallel chunks. The matches are the same as with search().
+    result search(std::string_view text, scan_context & context, thread_pool & pool, size_t chunk_size = PARALLEL_CHUNK_SIZE) const {
+      if (text.size() <= chunk_size) return search(text, context);
+      start(context, nullptr);
+      if (decide(0, context) == Outcome::NO_MATCH) return result(text);
+      scanParallel(text, context, pool, chunk_size, &context.offsets_);
+      Stopwatch stopwatch(context.statistics_.eval_ns_);
+      if (expressions_.empty()) return result(text);
+      auto matches = expressions_.front()->getMatches(context);
+      if (matches.empty()) return result(text, eval(context));
+      mapOffsets(matches, context.offsets_);
+      return result(text, std::move(matches));
+    }
+
+    // starts matching a text that is passed in chunks to feed()
+    void begin(scan_context & context) const {
+      begin(nullptr, context);
+    }
+
+    // starts matching a text with a metadata record, which must be kept alive
+    // until finish(). If the predicates decide the outcome, the chunks are ignored.
+    void begin(const metadata & record, scan_context & context) const {
+      begin(&record, context);
+    }
 
-      virtual void reset() {
-	if (left_) left_->reset();
-	if (right_) right_->reset();
+    // processes the next chunk of the text. The end of the chunk is held back
+    // until the next normalization boundary, so that UTF-8 sequences and
+    // combining characters can be split between chunks.
+    void feed(std::string_view chunk, scan_context & context) const {
+      if (context.is_decided_) return;
+      auto & pending = context.pending_;
+      pending += chunk;
+      auto n = findNormalizationBoundary(pending);
+      if (n > 0) {
+	normalize(std::string_view(pending).substr(0, n), context);
+	{
+	  Stopwatch stopwatch(context.statistics_.scan_ns_);
+	  updateState(context.text_, context);
+	}
+	pending.erase(0, n);
       }
+    }
 
-      virtual void getTerms(std::vector<std::pair<std::u32string, Node *>> & r) {
-	if (left_) left_->getTerms(r);
-	if (right_) right_->getTerms(r);
+    // processes the rest of the text and returns true if the first expression matches it
+    bool finish(scan_context & context) const {
+      normalize(context.pending_, context);
+      {
+	Stopwatch stopwatch(context.statistics_.scan_ns_);
+	updateState(context.text_, context);
+	finishState(context);
       }
-      
-    protected:
-      std::unique_ptr<Node> left_, right_;
-    };
+      context.pending_.clear();
+      Stopwatch stopwatch(context.statistics_.eval_ns_);
+      return eval(context);
+    }
 
-    // Term node contains the literal text to be found
-    class Term : public Node {
-    public:
-      Term(std::string term0, std::u32string_view term) : term0_(std::move(term0)) {
-	std::u32string suffix;
-	if (!term.empty() && term.front() == '*') term.remove_prefix(1);
-	else term_ += BOUNDARY;
-	if (!term.empty() && term.back() == '*') term.remove_suffix(1);
-	else suffix += BOUNDARY;
-	bool prev_is_word = false;
-	for (size_t i = 0; i < term.size(); i++) {
-	  auto is_word = isWordCharacter(term[i]);
-	  if (i > 0 && ((prev_is_word && !is_word) || (!prev_is_word && is_word))) {
-	    term_ += BOUNDARY;
-	  }
-	  prev_is_word = is_word;
-	  term_ += term[i];
-	}
-	term_ += suffix;
-	for (size_t i = 0; i < term_.size(); i++) {
-	  if (term_[i] > 0x20 && term_[i] != BOUNDARY) size_++;
-	}
+    // Evaluates each node of an expression separately for each text of a corpus
+    // and returns the nodes in preorder with the number of texts where they are
+    // true, the total size of their match lists and their evaluation time. This
+    // is slow and meant for finding out why an expression is expensive.
+    template<typename Texts>
+    std::vector<node_profile> profile(const Texts & texts, size_t query = 0) const {
+      if (query >= expressions_.size()) throw std::runtime_error("invalid expression id");
+      std::vector<const Node *> nodes;
+      std::vector<node_profile> r;
+      std::vector<std::pair<const Node *, size_t>> stack = { { expressions_[query].get(), 0 } };
+      while (!stack.empty()) {
+	auto [ node, depth ] = stack.back();
+	stack.pop_back();
+	nodes.push_back(node);
+	r.emplace_back();
+	node->serialize(r.back().expression_);
+	r.back().depth_ = depth;
+	auto & children = node->getChildren();
+	for (auto child = children.rbegin(); child != children.rend(); ++child) stack.emplace_back(child->get(), depth + 1);
       }
-      
-      bool eval() const override {
-	return !matches_.empty();
+
+      scan_context context;
+      for (auto & text : texts) {
+	start(context, nullptr);
+	scan(text, context);
+	for (size_t i = 0; i < nodes.size(); i++) {
+	  auto t0 = std::chrono::steady_clock::now();
+	  auto value = nodes[i]->eval(context);
+	  r[i].eval_ns_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+	  r[i].evaluations_++;
+	  if (value) r[i].hits_++;
+	  r[i].matches_ += nodes[i]->getMatches(context).size();
+	}
       }
-      std::vector<match_data> getMatches() const override {
-	return matches_;
+      return r;
+    }
+
+    // Orders the operands of ANDs and ORs by the rates of the texts of a sample
+    // where their terms are found, so that selective operands of ANDs and likely
+    // operands of ORs are evaluated first. Metadata predicates are always first.
+    // The results do not change apart from the order of the matches of search().
+    // The query must not be used by other threads during the call.
+    template<typename Texts>
+    void optimize(const Texts & sample) {
+      std::vector<double> term_rates(term_sizes_.size(), 0.0);
+      scan_context context;
+      for (auto & text : sample) {
+	start(context, nullptr);
+	scan(text, context);
+	for (auto term : context.matched_terms_) term_rates[term] += 1.0;
       }
-      void addMatch(int pos, int word_index) override {
-	matches_.emplace_back(pos - size_ + 1, size_, word_index);
+      if (sample.size()) {
+	for (auto & rate : term_rates) rate /= static_cast<double>(sample.size());
       }
-      void reset() override {
-	matches_.clear();
+      for (auto & expression : expressions_) expression->reorder(term_rates);
+      // the terms are renumbered in the new order, so that a saved query gets
+      // the same ids when it is loaded
+      term_sizes_.clear();
+      fragment_ids_.clear();
+      fragments_.clear();
+      programs_.clear();
+      has_fixed_operands_.clear();
+      fixed_queries_.clear();
+      compile();
+      // the order of the matches may have changed
+      id_ = result_cache::getQueryId();
+    }
+
+  private:
+    template<typename> friend class basic_matcher_set;
+    template<const char *, typename> friend class basic_static_matcher;
+    template<typename> friend class basic_document_index;
+
+    bool match(std::string_view text, const metadata * record, scan_context & context) const {
+      start(context, record);
+      auto outcome = decide(0, context);
+      if (outcome != Outcome::UNDECIDED) return outcome == Outcome::MATCH;
+      context.stop_early_ = true;
+      scan(text, context);
+      Stopwatch stopwatch(context.statistics_.eval_ns_);
+      return eval(context);
+    }
+
+    std::vector<size_t> match_all(std::string_view text, const metadata * record, scan_context & context) const {
+      start(context, record);
+      std::vector<size_t> r;
+      if (fixed_queries_.size() == expressions_.size()) {
+	bool is_decided = true;
+	for (size_t query = 0; query < expressions_.size() && is_decided; query++) {
+	  auto outcome = decide(query, context);
+	  if (outcome == Outcome::UNDECIDED) is_decided = false;
+	  else if (outcome == Outcome::MATCH) r.push_back(query);
+	}
+	if (is_decided) return r;
+	r.clear();
       }
-      void getTerms(std::vector<std::pair<std::u32string, Node *>> & r) override {
-	r.emplace_back(term_, this);
+      scan(text, context);
+      Stopwatch stopwatch(context.statistics_.eval_ns_);
+
+      // an expression without any term hits can only match through its predicates
+      for (auto query : context.hits_) {
+	if (evalExpression(query, context)) r.push_back(query);
       }
-      void serialize(std::string & r) const override {
-	if (!r.empty()) r += " ";
-	r += term0_;
+      for (auto query : fixed_queries_) {
+	if (!context.is_hit_[query] && evalExpression(query, context)) r.push_back(query);
       }
+      std::sort(r.begin(), r.end());
+      return r;
+    }
 
-    private:
-      std::string term0_;
-      std::u32string term_;
-      std::vector<match_data> matches_;
-      int size_ = 0;
+    result search(std::string_view text, const metadata * record, scan_context & context) const {
+      start(context, record);
+      if (decide(0, context) == Outcome::NO_MATCH) return result(text);
+      // the offset map is built in the same pass as the normalized text
+      scan(text, context, &context.offsets_);
+      Stopwatch stopwatch(context.statistics_.eval_ns_);
+      if (expressions_.empty()) return result(text);
+      auto matches = expressions_.front()->getMatches(context);
+      if (matches.empty()) return result(text, eval(context));
+      mapOffsets(matches, context.offsets_);
+      return result(text, std::move(matches));
+    }
+
+    template<typename Char>
+    bool matchNormalized(std::basic_string_view<Char> text, scan_context & context) const {
+      start(context, nullptr);
+      auto outcome = decide(0, context);
+      if (outcome != Outcome::UNDECIDED) return outcome == Outcome::MATCH;
+      context.stop_early_ = true;
+      {
+	Stopwatch stopwatch(context.statistics_.scan_ns_);
+	if constexpr (PROFILING) context.statistics_.bytes_ += text.size() * sizeof(Char);
+	if constexpr (std::is_same_v<Char, char>) {
+	  updateState(text, context);
+	} else {
+	  scanCodeUnits(text, context);
+	}
+	finishState(context);
+      }
+      Stopwatch stopwatch(context.statistics_.eval_ns_);
+      return eval(context);
+    }
+
+    void begin(const metadata * record, scan_context & context) const {
+      start(context, record);
+      context.stop_early_ = true;
+      context.is_decided_ = decide(0, context) != Outcome::UNDECIDED;
+      context.pending_.clear();
+    }
+
+    using Offset = scan_context::Offset;
+    using ChunkMatch = scan_context::ChunkMatch;
+
+    // returns the word class of a codepoint. ASCII is looked up from a bitset.
+    static constexpr word_class getWordClass(char32_t codepoint) noexcept {
+      if (codepoint < 0x80) {
+	constexpr uint64_t ASCII_WORDS[2] = { 0x03ff000000000000, 0x07fffffe87fffffe };
+	return (ASCII_WORDS[codepoint >> 6] >> (codepoint & 63)) & 1 ? word_class::WORD : word_class::NON_WORD;
+      }
+      return Tokenizer::get_class(codepoint);
+    }
+
+    // returns true if there is a word boundary between codepoints of two classes
+    static constexpr bool isBoundary(word_class prev, word_class current) noexcept {
+      return prev != current || current == word_class::SINGLE;
+    }
+
+    // decodes the UTF-8 sequence at position i of s and returns its length in bytes.
+    // An invalid byte is returned as a single non-word codepoint.
+    static size_t decodeCodepoint(std::string_view s, size_t i, char32_t & codepoint) noexcept {
+      auto c = static_cast<unsigned char>(s[i]);
+      if (c < 0x80) {
+	codepoint = c;
+	return 1;
+      }
+      utf8proc_int32_t cp;
+      auto n = utf8proc_iterate(reinterpret_cast<const utf8proc_uint8_t *>(s.data() + i), static_cast<utf8proc_ssize_t>(s.size() - i), &cp);
+      if (n <= 0) {
+	codepoint = 0xfffd;
+	return 1;
+      }
+      codepoint = static_cast<char32_t>(cp);
+      return static_cast<size_t>(n);
+    }
+
+    // decodes the UTF-16 or UTF-32 codepoint at position i of s and returns its
+    // length in code units. Unpaired surrogates and invalid values are returned as U+FFFD.
+    template<typename Char>
+    static size_t decodeCodeUnits(std::basic_string_view<Char> s, size_t i, char32_t & codepoint) noexcept {
+      auto c = static_cast<char32_t>(s[i]);
+      if constexpr (sizeof(Char) == 2) {
+	c &= 0xffff;
+	if (c >= 0xd800 && c < 0xdc00 && i + 1 < s.size()) {
+	  auto low = static_cast<char32_t>(s[i + 1]) & 0xffff;
+	  if (low >= 0xdc00 && low < 0xe000) {
+	    codepoint = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+	    return 2;
+	  }
+	}
+      }
+      codepoint = (c >= 0xd800 && c < 0xe000) || c > 0x10ffff ? 0xfffd : c;
+      return 1;
+    }
+
+    // writes the UTF-8 sequence of a valid codepoint and returns its length
+    static size_t encodeCodepoint(char32_t codepoint, char * out) noexcept {
+      if (codepoint < 0x80) {
+	out[0] = static_cast<char>(codepoint);
+	return 1;
+      } else if (codepoint < 0x800) {
+	out[0] = static_cast<char>(0xc0 | (codepoint >> 6));
+	out[1] = static_cast<char>(0x80 | (codepoint & 0x3f));
+	return 2;
+      } else if (codepoint < 0x10000) {
+	out[0] = static_cast<char>(0xe0 | (codepoint >> 12));
+	out[1] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+	out[2] = static_cast<char>(0x80 | (codepoint & 0x3f));
+	return 3;
+      }
+      out[0] = static_cast<char>(0xf0 | (codepoint >> 18));
+      out[1] = static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f));
+      out[2] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+      out[3] = static_cast<char>(0x80 | (codepoint & 0x3f));
+      return 4;
+    }
+
+    // converts a UTF-16 or UTF-32 text to UTF-8 in the input buffer of a context
+    template<typename Char>
+    static std::string_view toUtf8(std::basic_string_view<Char> text, scan_context & context) {
+      auto & r = context.input_;
+      // a code unit takes at most three bytes in UTF-16 and four in UTF-32
+      r.resize(text.size() * (sizeof(Char) == 2 ? 3 : 4));
+      size_t n = 0;
+      for (size_t i = 0; i < text.size(); ) {
+	char32_t codepoint;
+	i += decodeCodeUnits(text, i, codepoint);
+	n += encodeCodepoint(codepoint, &r[n]);
+      }
+      r.resize(n);
+      return r;
+    }
+
+    class Node;
+    class Term;
+
+    // the value of an expression during a scan
+    enum class Outcome { UNDECIDED, MATCH, NO_MATCH };
+
+    // the type of a record in a saved expression
+    enum class NodeType : uint8_t { TERM, AND, OR, AND_NOT, NEAR, PREDICATE, CONSTANT };
+
+    // an instruction of a postfix program that evaluates an expression
+    enum class Opcode : uint8_t { TERM, NODE, AND, OR, AND_NOT };
+    struct Instruction {
+      Opcode op;
+      uint32_t arg;
+    };
+
+    // A flat postfix program compiled from the boolean part of an expression. It
+    // reads the term hit bitset, and positional nodes are evaluated through NODE
+    // instructions. Programs of at most six terms are tabulated into a truth table.
+    struct Program {
+      void add(Opcode op, uint32_t arg = 0) {
+	code.push_back(Instruction{ op, arg });
+	if (op == Opcode::TERM || op == Opcode::NODE) depth = std::max(depth, ++stack_size);
+	else stack_size--;
+      }
+
+      std::vector<Instruction> code;
+      std::vector<const Node *> nodes;
+      uint32_t first_term = 0, term_count = 0, depth = 0, stack_size = 0;
+      uint64_t truth_table = 0;
+      bool has_truth_table = false;
+    };
+
+    // A node for the expression tree. After optimization ANDs and ORs have any
+    // number of operands, and the other operators have two.
+    class Node {
+    public:
+      Node() { }
+      Node(std::vector<std::unique_ptr<Node> > & node_stack) {
+	if (node_stack.size() < 2) throw std::runtime_error("stack underflow");
+
+	children_.resize(2);
+	children_[1] = std::move(node_stack.back());
+	node_stack.pop_back();
+	children_[0] = std::move(node_stack.back());
+	node_stack.pop_back();
+      }
+
+      virtual ~Node() { }
+
+      virtual bool eval(const scan_context & context) const = 0;
+      virtual std::vector<match_data> getMatches(const scan_context & context) const = 0;
+      virtual void serialize(std::string & r) const = 0;
+
+      // returns the matches of the node without copying them, if they are stored
+      virtual const std::vector<match_data> * getStoredMatches(const scan_context & context) const { return nullptr; }
+
+      // returns the value of the node if further term matches cannot change it
+      virtual Outcome getOutcome(const scan_context & context) const = 0;
+
+      // appends the postfix instructions for the node to a program
+      virtual void emit(Program & program) const = 0;
+
+      // appends the node to a saved query as postfix records
+      virtual void write(std::string & r) const = 0;
+
+      virtual void getTerms(std::vector<Term *> & r) {
+	for (auto & child : children_) child->getTerms(r);
+      }
+
+      const std::vector<std::unique_ptr<Node>> & getChildren() const noexcept { return children_; }
+
+      // returns true if the matches of the node can only grow when terms are matched
+      virtual bool isMonotone() const {
+	return std::all_of(children_.begin(), children_.end(), [](auto & child) { return child->isMonotone(); });
+      }
+
+      // returns true if the value of the node depends on the positions of the matches
+      virtual bool isPositional() const {
+	return std::any_of(children_.begin(), children_.end(), [](auto & child) { return child->isPositional(); });
+      }
+
+      // returns true if the node has operands whose value does not depend on the
+      // text, which are metadata predicates and constants
+      virtual bool hasFixedOperands() const {
+	return std::any_of(children_.begin(), children_.end(), [](auto & child) { return child->hasFixedOperands(); });
+      }
+
+      // returns MATCH or NO_MATCH if the node is a constant
+      virtual Outcome getConstant() const { return Outcome::UNDECIDED; }
+
+      // Simplifies the operands and returns a node that replaces this one, or
+      // nullptr if the node is kept. Terms under positional nodes are not folded.
+      virtual std::unique_ptr<Node> simplify(bool is_positional) {
+	simplifyOperands(is_positional);
+	return nullptr;
+      }
+
+      // returns the relative cost of evaluating the node
+      virtual int getCost() const { return isPositional() ? 3 : 2; }
+
+      // Orders the operands by the rates of the texts where terms are found and
+      // returns the estimated rate of the texts where the node is true
+      virtual double reorder(const std::vector<double> & term_rates) {
+	double r = 1.0;
+	for (auto & child : children_) r = std::min(r, child->reorder(term_rates));
+	return r;
+      }
+
+    protected:
+      void simplifyOperands(bool is_positional) {
+	for (auto & child : children_) {
+	  auto node = child->simplify(is_positional);
+	  if (node) child = std::move(node);
+	}
+      }
+
+      // Flattens operands of type T into this node, removes duplicate operands and
+      // constants that do not change the value, and returns a replacement if the
+      // node is decided by a constant or has a single operand left.
+      template<typename T>
+      std::unique_ptr<Node> simplifyChain(bool is_positional, Outcome absorbing) {
+	simplifyOperands(is_positional);
+	std::vector<std::unique_ptr<Node>> operands;
+	for (auto & child : children_) {
+	  if (auto chain = dynamic_cast<T *>(child.get())) {
+	    for (auto & operand : chain->children_) operands.push_back(std::move(operand));
+	  } else {
+	    operands.push_back(std::move(child));
+	  }
+	}
+	children_.clear();
+	std::vector<std::string> keys;
+	for (auto & operand : operands) {
+	  auto constant = operand->getConstant();
+	  if (constant == absorbing) return std::move(operand);
+	  if (constant != Outcome::UNDECIDED) continue;
+	  std::string key;
+	  operand->serialize(key);
+	  if (std::find(keys.begin(), keys.end(), key) != keys.end()) continue;
+	  keys.push_back(std::move(key));
+	  children_.push_back(std::move(operand));
+	}
+	if (children_.empty()) return std::make_unique<Constant>(absorbing == Outcome::NO_MATCH);
+	if (children_.size() == 1) return std::move(children_.front());
+	return nullptr;
+      }
+
+      // emits the operands as a flat sequence joined by op to keep the stack shallow
+      void emitChain(Program & program, Opcode op) const {
+	children_.front()->emit(program);
+	for (size_t i = 1; i < children_.size(); i++) {
+	  children_[i]->emit(program);
+	  program.add(op);
+	}
+      }
+
+      // writes the operands as a chain of binary records
+      void writeChain(std::string & r, NodeType type) const {
+	children_.front()->write(r);
+	for (size_t i = 1; i < children_.size(); i++) {
+	  children_[i]->write(r);
+	  appendValue(r, type);
+	}
+      }
+
+      void serializeChain(std::string & r, const char * op) const {
+	if (!r.empty()) r += " ";
+	r += "(";
+	for (size_t i = 0; i < children_.size(); i++) {
+	  if (i) r += op;
+	  children_[i]->serialize(r);
+	}
+	r += ")";
+      }
+
+      // orders the operands by their cost and then by their rates, and returns the rates
+      std::vector<double> sortOperands(const std::vector<double> & term_rates, bool is_ascending) {
+	std::vector<std::pair<double, size_t>> keys;
+	for (size_t i = 0; i < children_.size(); i++) {
+	  keys.emplace_back(children_[i]->reorder(term_rates), i);
+	}
+	std::stable_sort(keys.begin(), keys.end(), [&](auto & a, auto & b) {
+	  auto cost_a = children_[a.second]->getCost(), cost_b = children_[b.second]->getCost();
+	  if (cost_a != cost_b) return cost_a < cost_b;
+	  return is_ascending ? a.first < b.first : a.first > b.first;
+	});
+	std::vector<std::unique_ptr<Node>> children;
+	std::vector<double> rates;
+	for (auto & [ rate, i ] : keys) {
+	  children.push_back(std::move(children_[i]));
+	  rates.push_back(rate);
+	}
+	children_ = std::move(children);
+	return rates;
+      }
+
+      // returns the matches of a node, which are evaluated into tmp if they are not stored
+      static const std::vector<match_data> & getMatchList(const Node & node, const scan_context & context, std::vector<match_data> & tmp) {
+	auto matches = node.getStoredMatches(context);
+	if (matches) return *matches;
+	tmp = node.getMatches(context);
+	return tmp;
+      }
+
+      std::vector<std::unique_ptr<Node>> children_;
+    };
+
+    // Constant node is the result of folding, e.g. a bare wildcard is true
+    class Constant : public Node {
+    public:
+      explicit Constant(bool value) : value_(value) { }
+
+      bool eval(const scan_context & context) const override { return value_; }
+      Outcome getOutcome(const scan_context & context) const override { return getConstant(); }
+      Outcome getConstant() const override { return value_ ? Outcome::MATCH : Outcome::NO_MATCH; }
+      void emit(Program & program) const override {
+	program.add(Opcode::NODE, static_cast<uint32_t>(program.nodes.size()));
+	program.nodes.push_back(this);
+      }
+      void write(std::string & r) const override {
+	appendValue(r, NodeType::CONSTANT);
+	appendValue(r, static_cast<uint8_t>(value_));
+      }
+      std::vector<match_data> getMatches(const scan_context & context) const override {
+	return std::vector<match_data>();
+      }
+      bool hasFixedOperands() const override { return true; }
+      int getCost() const override { return 0; }
+      double reorder(const std::vector<double> & term_rates) override { return value_ ? 1.0 : 0.0; }
+      void serialize(std::string & r) const override {
+	if (!r.empty()) r += " ";
+	r += value_ ? "*" : "(* NOT *)";
+      }
+
+    private:
+      bool value_;
+    };
+
+    // A pattern for the automaton, its size in bytes without the boundaries and
+    // the number of words that start after its first character
+    struct Pattern {
+      std::string text;
+      int size = 0, word_starts = 0;
+    };
+
+    // Term node contains the literal text to be found. Wildcards between word
+    // characters (e.g. colo*r) split the term into fragments that are matched
+    // as separate patterns and joined within a word during the scan.
+    class Term : public Node {
+    public:
+      explicit Term(std::string term0) : term0_(std::move(term0)) {
+	std::string_view term = term0_;
+	std::string suffix;
+	patterns_.emplace_back();
+	if (!term.empty() && term.front() == '*') term.remove_prefix(1);
+	else patterns_.back().text += BOUNDARY;
+	if (!term.empty() && term.back() == '*') term.remove_suffix(1);
+	else suffix += BOUNDARY;
+	auto prev_class = word_class::NON_WORD;
+	bool is_fragment_start = true;
+	for (size_t i = 0; i < term.size(); ) {
+	  char32_t codepoint;
+	  auto n = decodeCodepoint(term, i, codepoint);
+	  auto cls = getWordClass(codepoint);
+	  if (codepoint == '*' && prev_class != word_class::NON_WORD) {
+	    // a run of wildcards followed by a word character starts a new fragment
+	    auto j = term.find_first_not_of('*', i);
+	    char32_t next;
+	    if (j != std::string_view::npos && (decodeCodepoint(term, j, next), getWordClass(next) != word_class::NON_WORD)) {
+	      patterns_.emplace_back();
+	      is_fragment_start = true;
+	      i = j;
+	      continue;
+	    }
+	  }
+	  auto & pattern = patterns_.back();
+	  if (!is_fragment_start && isBoundary(prev_class, cls)) {
+	    pattern.text += BOUNDARY;
+	    if (cls != word_class::NON_WORD) pattern.word_starts++;
+	  }
+	  prev_class = cls;
+	  is_fragment_start = false;
+	  pattern.text += term.substr(i, n);
+	  pattern.size += static_cast<int>(n);
+	  i += n;
+	}
+	patterns_.back().text += suffix;
+      }
+      
+      bool eval(const scan_context & context) const override {
+	return !context.matches_[id_].empty();
+      }
+      Outcome getOutcome(const scan_context & context) const override {
+	return eval(context) ? Outcome::MATCH : Outcome::UNDECIDED;
+      }
+      void emit(Program & program) const override {
+	program.add(Opcode::TERM, id_);
+      }
+      void write(std::string & r) const override {
+	appendValue(r, NodeType::TERM);
+	appendValue(r, id_);
+	appendValue(r, static_cast<uint32_t>(term0_.size()));
+	r += term0_;
+      }
+      std::vector<match_data> getMatches(const scan_context & context) const override {
+	return context.matches_[id_];
+      }
+      const std::vector<match_data> * getStoredMatches(const scan_context & context) const override {
+	return &context.matches_[id_];
+      }
+      void getTerms(std::vector<Term *> & r) override {
+	r.push_back(this);
+      }
+      void serialize(std::string & r) const override {
+	if (!r.empty()) r += " ";
+	r += term0_;
+      }
+      // a bare wildcard is true unless it is matched by position
+      std::unique_ptr<Node> simplify(bool is_positional) override {
+	if (is_positional || term0_.find_first_not_of('*') != std::string::npos) return nullptr;
+	return std::make_unique<Constant>(true);
+      }
+      int getCost() const override { return 1; }
+      double reorder(const std::vector<double> & term_rates) override { return term_rates[id_]; }
+
+      // returns the normalized text of the term
+      const std::string & getText() const noexcept { return term0_; }
+
+      // returns the patterns for the automaton, which are the fragments of a wildcard term
+      const std::vector<Pattern> & getPatterns() const noexcept { return patterns_; }
+      bool hasWildcard() const noexcept { return patterns_.size() > 1; }
+      // returns the size of a match in bytes, which varies for wildcard terms
+      int getSize() const noexcept { return hasWildcard() ? 0 : patterns_.front().size; }
+      uint32_t getId() const noexcept { return id_; }
+      void setId(uint32_t id) noexcept { id_ = id; }
+      // the id of the first fragment of a wildcard term
+      uint32_t getFragmentId() const noexcept { return fragment_id_; }
+      void setFragmentId(uint32_t id) noexcept { fragment_id_ = id; }
+
+    private:
+      std::string term0_;
+      std::vector<Pattern> patterns_;
+      uint32_t id_ = 0, fragment_id_ = 0;
+    };
+
+    // the operator of a metadata predicate
+    enum class Comparison : uint8_t { EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL };
+
+    // Predicate node compares a field of the metadata record with a constant. A
+    // quoted value is a string and an unquoted one is a number if it can be
+    // parsed as one. A field that is missing or has a different type is false.
+    // The value of a predicate does not change during the scan, so it can decide
+    // the expression before the text is read.
+    class Predicate : public Node {
+    public:
+      Predicate(std::string key, Comparison op, std::string value, bool is_number)
+	: key_(std::move(key)), value_(std::move(value)), op_(op), is_number_(is_number) {
+	if (is_number_) number_ = std::strtod(value_.c_str(), nullptr);
+      }
+
+      bool eval(const scan_context & context) const override {
+	auto value = context.metadata_ ? context.metadata_->get(key_) : nullptr;
+	if (!value) return false;
+	if (is_number_) {
+	  auto number = std::get_if<double>(value);
+	  return number && compare(*number < number_ ? -1 : (*number > number_ ? 1 : 0));
+	} else {
+	  auto text = std::get_if<std::string>(value);
+	  return text && compare(text->compare(value_));
+	}
+      }
+      Outcome getOutcome(const scan_context & context) const override {
+	return eval(context) ? Outcome::MATCH : Outcome::NO_MATCH;
+      }
+      // predicates are evaluated through the node like positional nodes
+      void emit(Program & program) const override {
+	program.add(Opcode::NODE, static_cast<uint32_t>(program.nodes.size()));
+	program.nodes.push_back(this);
+      }
+      void write(std::string & r) const override {
+	std::string predicate;
+	serialize(predicate);
+	appendValue(r, NodeType::PREDICATE);
+	appendValue(r, static_cast<uint32_t>(predicate.size()));
+	r += predicate;
+      }
+      // a predicate is true without any matches in the text
+      std::vector<match_data> getMatches(const scan_context & context) const override {
+	return std::vector<match_data>();
+      }
+      bool hasFixedOperands() const override { return true; }
+      int getCost() const override { return 0; }
+      // the rate of a field value is not known
+      double reorder(const std::vector<double> & term_rates) override { return 0.5; }
+      void serialize(std::string & r) const override {
+	static constexpr const char * OPERATORS[] = { "=", "!=", "<", "<=", ">", ">=" };
+	if (!r.empty()) r += " ";
+	r += "." + key_ + " " + OPERATORS[static_cast<int>(op_)] + " ";
+	if (is_number_) r += value_;
+	else r += "\"" + value_ + "\"";
+      }
+
+    private:
+      // applies the operator to the result of a three-way comparison
+      bool compare(int c) const noexcept {
+	switch (op_) {
+	case Comparison::EQUAL: return c == 0;
+	case Comparison::NOT_EQUAL: return c != 0;
+	case Comparison::LESS: return c < 0;
+	case Comparison::LESS_EQUAL: return c <= 0;
+	case Comparison::GREATER: return c > 0;
+	case Comparison::GREATER_EQUAL: return c >= 0;
+	}
+	return false;
+      }
+
+      std::string key_, value_;
+      double number_ = 0.0;
+      Comparison op_;
+      bool is_number_;
+    };
+
+    class And : public Node {
+    public:
+      And(std::vector<std::unique_ptr<Node> > & node_stack) : Node(node_stack) { }
+      using Node::children_;
+
+      bool eval(const scan_context & context) const override {
+	for (auto & child : children_) {
+	  if (!child->eval(context)) return false;
+	}
+	return true;
+      }
+
+      Outcome getOutcome(const scan_context & context) const override {
+	auto r = Outcome::MATCH;
+	for (auto & child : children_) {
+	  auto outcome = child->getOutcome(context);
+	  if (outcome == Outcome::NO_MATCH) return outcome;
+	  if (outcome == Outcome::UNDECIDED) r = outcome;
+	}
+	return r;
+      }
+
+      void emit(Program & program) const override {
+	this->emitChain(program, Opcode::AND);
+      }
+
+      void write(std::string & r) const override {
+	this->writeChain(r, NodeType::AND);
+      }
+
+      std::unique_ptr<Node> simplify(bool is_positional) override {
+	return this->template simplifyChain<And>(is_positional, Outcome::NO_MATCH);
+      }
+
+      // selective operands are evaluated first
+      double reorder(const std::vector<double> & term_rates) override {
+	double r = 1.0;
+	for (auto rate : this->sortOperands(term_rates, true)) r *= rate;
+	return r;
+      }
+
+      std::vector<match_data> getMatches(const scan_context & context) const override {
+	std::vector<match_data> r, tmp;
+	for (auto & child : children_) {
+	  auto & matches = this->getMatchList(*child, context, tmp);
+	  // a predicate is true without matches
+	  if (matches.empty() && !child->eval(context)) return std::vector<match_data>();
+	  r.insert(r.end(), matches.begin(), matches.end());
+	}
+	return r;
+      }
+
+      void serialize(std::string & r) const override {
+	this->serializeChain(r, " AND");
+      }
+    };
+
+    class Or : public Node {
+    public:
+      Or(std::vector<std::unique_ptr<Node> > & node_stack) : Node(node_stack) { }
+      using Node::children_;
+
+      bool eval(const scan_context & context) const override {
+	for (auto & child : children_) {
+	  if (child->eval(context)) return true;
+	}
+	return false;
+      }
+
+      Outcome getOutcome(const scan_context & context) const override {
+	auto r = Outcome::NO_MATCH;
+	for (auto & child : children_) {
+	  auto outcome = child->getOutcome(context);
+	  if (outcome == Outcome::MATCH) return outcome;
+	  if (outcome == Outcome::UNDECIDED) r = outcome;
+	}
+	return r;
+      }
+
+      void emit(Program & program) const override {
+	this->emitChain(program, Opcode::OR);
+      }
+
+      void write(std::string & r) const override {
+	this->writeChain(r, NodeType::OR);
+      }
+
+      std::unique_ptr<Node> simplify(bool is_positional) override {
+	return this->template simplifyChain<Or>(is_positional, Outcome::MATCH);
+      }
+
+      // likely operands are evaluated first
+      double reorder(const std::vector<double> & term_rates) override {
+	double r = 1.0;
+	for (auto rate : this->sortOperands(term_rates, false)) r *= 1.0 - rate;
+	return 1.0 - r;
+      }
+
+      // the matches of all operands are concatenated once
+      std::vector<match_data> getMatches(const scan_context & context) const override {
+	std::vector<match_data> r, tmp;
+	for (auto & child : children_) {
+	  auto & matches = this->getMatchList(*child, context, tmp);
+	  r.insert(r.end(), matches.begin(), matches.end());
+	}
+	return r;
+      }
+
+      void serialize(std::string & r) const override {
+	this->serializeChain(r, " OR");
+      }
+    };
+
+    class AndNot : public Node {
+    public:
+      AndNot(std::vector<std::unique_ptr<Node> > & node_stack) : Node(node_stack) { }
+      using Node::children_;
+
+      bool eval(const scan_context & context) const override {
+	if (children_[1]->eval(context)) return false;
+	return children_[0]->eval(context);
+      }
+
+      Outcome getOutcome(const scan_context & context) const override {
+	auto right = children_[1]->getOutcome(context);
+	if (right == Outcome::MATCH) return Outcome::NO_MATCH;
+	auto left = children_[0]->getOutcome(context);
+	if (left == Outcome::NO_MATCH) return left;
+	return left == Outcome::MATCH && right == Outcome::NO_MATCH ? Outcome::MATCH : Outcome::UNDECIDED;
+      }
+
+      void emit(Program & program) const override {
+	children_[0]->emit(program);
+	children_[1]->emit(program);
+	program.add(Opcode::AND_NOT);
+      }
+
+      void write(std::string & r) const override {
+	this->writeChain(r, NodeType::AND_NOT);
+      }
+
+      // a constant on the right side removes the node
+      std::unique_ptr<Node> simplify(bool is_positional) override {
+	this->simplifyOperands(is_positional);
+	auto right = children_[1]->getConstant();
+	if (right == Outcome::MATCH || children_[0]->getConstant() == Outcome::NO_MATCH) return std::make_unique<Constant>(false);
+	if (right == Outcome::NO_MATCH) return std::move(children_[0]);
+	return nullptr;
+      }
+
+      double reorder(const std::vector<double> & term_rates) override {
+	auto left = children_[0]->reorder(term_rates);
+	return left * (1.0 - children_[1]->reorder(term_rates));
+      }
+
+      // a match of the right side removes the matches of the left side
+      bool isMonotone() const override { return false; }
+
+      std::vector<match_data> getMatches(const scan_context & context) const override {
+	if (children_[1]->eval(context)) {
+	  return std::vector<match_data>();
+	} else {
+	  return children_[0]->getMatches(context);
+	}
+      }
+
+      void serialize(std::string & r) const override {
+	this->serializeChain(r, " NOT");
+      }
+    };
+
+    // Near matches when a match of the right side is at most left_distance words
+    // before or right_distance words after a match of the left side
+    class Near : public Node {
+    public:
+      Near(std::vector<std::unique_ptr<Node> > & node_stack, int left_distance = 4, int right_distance = 4)
+	: Node(node_stack),
+	  left_distance_(left_distance),
+	  right_distance_(right_distance) {
+	if (children_[0]->hasFixedOperands() || children_[1]->hasFixedOperands()) throw std::runtime_error("metadata predicate in a proximity operator");
+      }
+      using Node::children_;
+
+      bool eval(const scan_context & context) const override {
+	std::vector<match_data> left_tmp, right_tmp;
+	auto & left_matches = getSortedMatches(*children_[0], context, left_tmp);
+	if (left_matches.empty()) return false;
+	auto & right_matches = getSortedMatches(*children_[1], context, right_tmp);
+
+	// the first right match that is not too far behind is the only candidate
+	size_t j = 0;
+	for (auto & left_match : left_matches) {
+	  while (j < right_matches.size() && right_matches[j].word_index_ < left_match.word_index_ - left_distance_) j++;
+	  if (j == right_matches.size()) return false;
+	  if (right_matches[j].word_index_ <= left_match.word_index_ + right_distance_) return true;
+	}
+	return false;
+      }
+
+      Outcome getOutcome(const scan_context & context) const override {
+	if (children_[0]->getOutcome(context) == Outcome::NO_MATCH || children_[1]->getOutcome(context) == Outcome::NO_MATCH) {
+	  return Outcome::NO_MATCH;
+	}
+	// pairs of matches can disappear only if the operands are not monotone
+	if (this->isMonotone() && eval(context)) return Outcome::MATCH;
+	return Outcome::UNDECIDED;
+      }
+
+      bool isPositional() const override { return true; }
+
+      // the operands are matched by position, so a bare wildcard is not folded
+      std::unique_ptr<Node> simplify(bool is_positional) override {
+	this->simplifyOperands(true);
+	return nullptr;
+      }
+
+      // positional nodes are evaluated with the match lists
+      void emit(Program & program) const override {
+	program.add(Opcode::NODE, static_cast<uint32_t>(program.nodes.size()));
+	program.nodes.push_back(this);
+      }
+
+      void write(std::string & r) const override {
+	this->writeChain(r, NodeType::NEAR);
+	appendValue(r, static_cast<int32_t>(left_distance_));
+	appendValue(r, static_cast<int32_t>(right_distance_));
+      }
+
+      // returns the matches of both sides that are part of at least one pair
+      std::vector<match_data> getMatches(const scan_context & context) const override {
+	std::vector<match_data> left_tmp, right_tmp, left_result, right_result;
+	auto & left_matches = getSortedMatches(*children_[0], context, left_tmp);
+	if (left_matches.empty()) return left_result;
+	auto & right_matches = getSortedMatches(*children_[1], context, right_tmp);
+
+	// the window [lo, hi) of right matches in range only moves forward
+	size_t lo = 0, hi = 0;
+	for (auto & left_match : left_matches) {
+	  while (lo < right_matches.size() && right_matches[lo].word_index_ < left_match.word_index_ - left_distance_) lo++;
+	  auto first_new = std::max(lo, hi);
+	  hi = first_new;
+	  while (hi < right_matches.size() && right_matches[hi].word_index_ <= left_match.word_index_ + right_distance_) hi++;
+	  if (lo < hi) {
+	    left_result.push_back(left_match);
+	    right_result.insert(right_result.end(), right_matches.begin() + static_cast<std::ptrdiff_t>(first_new), right_matches.begin() + static_cast<std::ptrdiff_t>(hi));
+	  }
+	}
+
+	std::vector<match_data> result;
+	result.reserve(left_result.size() + right_result.size());
+	std::merge(left_result.begin(), left_result.end(), right_result.begin(), right_result.end(), std::back_inserter(result), compareMatches);
+	return result;
+      }
+
+      void serialize(std::string & r) const override {
+	if (!r.empty()) r += " ";
+	r += "(";
+	children_[0]->serialize(r);
+	if (left_distance_ == 0) r += " ONEAR";
+	else r += " NEAR";
+	if (right_distance_ != 4) r += "/" + std::to_string(right_distance_);
+	children_[1]->serialize(r);
+	r += ")";
+      }
+
+    private:
+      static bool compareMatches(const match_data & a, const match_data & b) noexcept {
+	return a.word_index_ < b.word_index_ || (a.word_index_ == b.word_index_ && a.pos_ < b.pos_);
+      }
+
+      // returns the matches of a node sorted by word index. The matches of terms
+      // are already sorted, and other nodes are evaluated into tmp.
+      static const std::vector<match_data> & getSortedMatches(const Node & node, const scan_context & context, std::vector<match_data> & tmp) {
+	auto matches = node.getStoredMatches(context);
+	if (matches) return *matches;
+	tmp = node.getMatches(context);
+	if (!std::is_sorted(tmp.begin(), tmp.end(), compareMatches)) {
+	  std::sort(tmp.begin(), tmp.end(), compareMatches);
+	}
+	return tmp;
+      }
+
+      int left_distance_, right_distance_;
+    };
+
+    // marks a metadata predicate in the tokens of an expression
+    static constexpr char PREDICATE = '\x02';
+
+    // the flags of the bytes that can start a pattern from the root
+    static constexpr uint8_t START = 1, START_AFTER_BOUNDARY = 2;
+
+    // A fragment of a wildcard term: the id of the term, the index of the
+    // fragment in the term and the words that start after its first character
+    struct Fragment {
+      uint32_t term, index, last_index;
+      int word_starts;
+    };
+    static constexpr uint32_t NO_FRAGMENT = 0xffffffff;
+
+    // the default size of the chunks of a text that is scanned in parallel
+    static constexpr size_t PARALLEL_CHUNK_SIZE = 1 << 20;
+
+    // An output of the automaton: a term tagged with the id of its expression
+    struct Output {
+      uint32_t term, query;
+    };
+
+    static constexpr char FILE_MAGIC[8] = { 'B', 'S', 'Q', 'U', 'E', 'R', 'Y', '\0' };
+    static constexpr uint32_t FILE_VERSION = 7;
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    // The header of a saved query. Sections are aligned to 8 bytes and their
+    // offsets are relative to the start of the file.
+    struct FileHeader {
+      char magic[8];
+      uint32_t version = FILE_VERSION, byte_order = BYTE_ORDER_MARK;
+      uint32_t tokenizer = Tokenizer::ID, reserved = 0;
+      uint64_t expression_count = 0, expressions_offset = 0, expressions_size = 0, term_count = 0;
+      uint32_t class_count = 0, row_size = 0;
+      uint64_t state_count = 0;
+      uint64_t transitions_offset = 0, transition_count = 0, outputs_offset = 0, output_count = 0;
+      uint32_t classes[256];
+    };
+
+    // A trie of the patterns for building the automaton. The states are kept in
+    // a single array, and the children of each state form a linked list, so that
+    // large dictionaries do not need an allocation per state.
+    class Trie {
+    public:
+      Trie() : states_(1) { }
+
+      // adds a pattern and returns its final state
+      uint32_t addPattern(std::string_view pattern) {
+	uint32_t state = 0;
+	for (auto character : pattern) {
+	  auto child = findChild(state, character);
+	  if (!child) {
+	    child = static_cast<uint32_t>(states_.size());
+	    states_.emplace_back();
+	    states_[child].character = character;
+	    states_[child].next_sibling = states_[state].first_child;
+	    states_[state].first_child = child;
+	  }
+	  state = child;
+	}
+	return state;
+      }
+
+      void addOutput(uint32_t state, uint32_t term, uint32_t query) {
+	outputs_.emplace_back(state, Output{ term, query });
+      }
+
+      // returns the child of a state for a character, or zero if there is none
+      uint32_t findChild(uint32_t state, char character) const noexcept {
+	for (auto child = states_[state].first_child; child; child = states_[child].next_sibling) {
+	  if (states_[child].character == character) return child;
+	}
+	return 0;
+      }
+
+      // returns the states in breadth-first order
+      std::vector<uint32_t> getStates() const {
+	std::vector<uint32_t> r = { 0 };
+	for (size_t i = 0; i < r.size(); i++) {
+	  for (auto child = states_[r[i]].first_child; child; child = states_[child].next_sibling) {
+	    r.push_back(child);
+	  }
+	}
+	return r;
+      }
+
+      uint32_t getFirstChild(uint32_t state) const noexcept { return states_[state].first_child; }
+      uint32_t getNextSibling(uint32_t state) const noexcept { return states_[state].next_sibling; }
+      char getCharacter(uint32_t state) const noexcept { return states_[state].character; }
+      size_t size() const noexcept { return states_.size(); }
+
+      // returns the outputs sorted by state, keeping the order of each state
+      std::vector<std::pair<uint32_t, Output>> getOutputs() const {
+	auto r = outputs_;
+	std::stable_sort(r.begin(), r.end(), [](auto & a, auto & b) { return a.first < b.first; });
+	return r;
+      }
+
+    private:
+      struct State {
+	uint32_t first_child = 0, next_sibling = 0;
+	char character = 0;
+      };
+      std::vector<State> states_;
+      std::vector<std::pair<uint32_t, Output>> outputs_;
+    };
+
+    // A compiled Aho-Corasick automaton over UTF-8 bytes. The failure transitions
+    // are folded into a full goto function which is stored in a flat table indexed
+    // by state and byte class, so that each step is a single load. Each row ends
+    // with the range of the own outputs of the state in a shared output array and
+    // a link to the nearest state on its failure chain that has outputs.
+    class Automaton {
+    public:
+      Automaton() { }
+
+      // compiles the automaton from a trie
+      void compile(const Trie & trie) {
+	// each byte of the patterns gets its own class, and class 0 is for the rest
+	auto states = trie.getStates();
+	class_count_ = 1;
+	classes_.fill(0);
+	for (size_t i = 1; i < states.size(); i++) {
+	  auto & c = classes_[static_cast<unsigned char>(trie.getCharacter(states[i]))];
+	  if (!c) c = class_count_++;
+	}
+	row_size_ = class_count_ + 3;
+
+	// the rows are in breadth-first order, and each state is stored as its row offset
+	std::vector<uint32_t> rows(trie.size());
+	for (size_t i = 0; i < states.size(); i++) rows[states[i]] = static_cast<uint32_t>(i * row_size_);
+
+	// the outputs of the root (empty patterns) are never reported
+	auto outputs = trie.getOutputs();
+	outputs_.clear();
+	std::vector<std::pair<uint32_t, uint32_t>> output_ranges(trie.size());
+	for (auto & [ state, output ] : outputs) {
+	  if (!state) continue;
+	  if (output_ranges[state].first == output_ranges[state].second) output_ranges[state].first = static_cast<uint32_t>(outputs_.size());
+	  outputs_.push_back(output);
+	  output_ranges[state].second = static_cast<uint32_t>(outputs_.size());
+	}
+	output_count_ = outputs_.size();
+
+	// the failure state of a state is shallower, so its row is complete when
+	// the state is reached
+	transitions_.assign(states.size() * row_size_, 0);
+	std::vector<uint32_t> failures(trie.size(), 0);
+	for (auto state : states) {
+	  auto row = &transitions_[rows[state]];
+	  auto failure_row = &transitions_[rows[failures[state]]];
+	  if (state) {
+	    std::copy(failure_row, failure_row + class_count_, row);
+	    bool failure_has_output = failure_row[class_count_] != failure_row[class_count_ + 1];
+	    row[class_count_ + 2] = failure_has_output ? rows[failures[state]] : failure_row[class_count_ + 2];
+	  }
+	  row[class_count_] = output_ranges[state].first;
+	  row[class_count_ + 1] = output_ranges[state].second;
+	  for (auto child = trie.getFirstChild(state); child; child = trie.getNextSibling(child)) {
+	    auto c = getClass(trie.getCharacter(child));
+	    // the failure of the child follows the same character from the failure of the state
+	    failures[child] = state ? states[failure_row[c] / row_size_] : 0;
+	    row[c] = rows[child];
+	  }
+	}
+	state_count_ = states.size();
+	transition_data_ = transitions_.data();
+	output_data_ = outputs_.data();
+	computePrefilter();
+      }
+
+      // appends the tables to a saved query
+      void write(FileHeader & header, std::string & r) const {
+	header.class_count = class_count_;
+	header.row_size = row_size_;
+	header.state_count = state_count_;
+	std::copy(classes_.begin(), classes_.end(), header.classes);
+	header.transition_count = state_count_ * row_size_;
+	header.transitions_offset = appendArray(r, transition_data_, header.transition_count);
+	header.output_count = output_count_;
+	header.outputs_offset = appendArray(r, output_data_, header.output_count);
+      }
+
+      // uses the tables of a saved query without copying them
+      void map(const FileHeader & header, const uint32_t * transitions, const Output * outputs) {
+	if (header.class_count == 0 || header.class_count > 256 || header.row_size != header.class_count + 3 ||
+	    header.state_count == 0 || header.transition_count / header.row_size != header.state_count ||
+	    header.transition_count % header.row_size != 0) {
+	  throw std::runtime_error("invalid query file");
+	}
+	for (auto c : header.classes) {
+	  if (c >= header.class_count) throw std::runtime_error("invalid query file");
+	}
+	class_count_ = header.class_count;
+	row_size_ = header.row_size;
+	state_count_ = header.state_count;
+	std::copy(std::begin(header.classes), std::end(header.classes), classes_.begin());
+	transitions_.clear();
+	outputs_.clear();
+	transition_data_ = transitions;
+	output_data_ = outputs;
+	output_count_ = header.output_count;
+	computePrefilter();
+      }
+
+      // returns the initial state
+      uint32_t getRoot() const noexcept { return 0; }
+
+      // returns the state after reading a byte
+      uint32_t getTransition(uint32_t state, char character) const noexcept {
+	return transition_data_[state + getClass(character)];
+      }
+
+      // returns true if the state or a state on its failure chain has outputs
+      bool hasOutput(uint32_t state) const noexcept {
+	auto row = transition_data_ + state + class_count_;
+	return (row[0] != row[1]) | (row[2] != 0);
+      }
+
+      // returns the own outputs of a state
+      std::pair<const Output *, const Output *> getOutput(uint32_t state) const noexcept {
+	return std::make_pair(output_data_ + transition_data_[state + class_count_], output_data_ + transition_data_[state + class_count_ + 1]);
+      }
+
+      // returns the outputs of all states
+      std::pair<const Output *, const Output *> getOutputs() const noexcept {
+	return std::make_pair(output_data_, output_data_ + output_count_);
+      }
+
+      // returns the next state on the failure chain that has outputs, or the root if there is none
+      uint32_t getOutputLink(uint32_t state) const noexcept {
+	return transition_data_[state + class_count_ + 2];
+      }
+
+      // returns true if the text can be skipped while the automaton is at the root
+      bool hasPrefilter() const noexcept { return has_prefilter_; }
+
+      // returns the flags of the patterns that can start with a byte
+      uint8_t getStartFlags(char character) const noexcept {
+	return start_flags_[static_cast<unsigned char>(character)];
+      }
+
+      // Returns a table that maps the low nibble of a byte to a bitset of the high
+      // nibbles of the ASCII bytes that have a start flag
+      const std::array<uint8_t, 16> & getStartNibbles(uint8_t flag) const noexcept {
+	return start_nibbles_[flag == START ? 0 : 1];
+      }
+
+      size_t getStateCount() const noexcept { return state_count_; }
+
+      // returns the size of the tables in bytes, including mapped tables
+      size_t getMemoryUsage() const noexcept {
+	return sizeof(Automaton) + state_count_ * row_size_ * sizeof(uint32_t) + output_count_ * sizeof(Output);
+      }
+
+    private:
+      uint32_t getClass(char character) const noexcept {
+	return classes_[static_cast<unsigned char>(character)];
+      }
+
+      // Finds the bytes that move the automaton away from the root, either directly
+      // or after a word boundary. Other bytes lead back to the root without
+      // outputs, so they can be skipped while the automaton is at the root.
+      void computePrefilter() {
+	start_flags_.fill(0);
+	for (auto & nibbles : start_nibbles_) nibbles.fill(0);
+	auto root = getRoot();
+	auto boundary_state = getTransition(root, BOUNDARY);
+	// the skipped text is assumed to pass through the boundary state only
+	has_prefilter_ = !hasOutput(root) && !hasOutput(boundary_state);
+	for (size_t c = 0; c < 256; c++) {
+	  auto character = static_cast<char>(c);
+	  if (character == BOUNDARY) continue;
+	  uint8_t flags = 0;
+	  if (getTransition(root, character) != root) flags |= START;
+	  if (getTransition(boundary_state, character) != root) flags |= START_AFTER_BOUNDARY;
+	  start_flags_[c] = flags;
+	  if (c < 0x80) {
+	    if (flags & START) start_nibbles_[0][c & 15] |= static_cast<uint8_t>(1 << (c >> 4));
+	    if (flags & START_AFTER_BOUNDARY) start_nibbles_[1][c & 15] |= static_cast<uint8_t>(1 << (c >> 4));
+	  }
+	}
+      }
+
+      uint32_t class_count_ = 1, row_size_ = 4;
+      size_t state_count_ = 0;
+      std::array<uint32_t, 256> classes_;
+      // states are stored as row offsets into the table
+      std::vector<uint32_t> transitions_;
+      std::vector<Output> outputs_;
+      // the tables in use, which are either owned or mapped from a file
+      const uint32_t * transition_data_ = nullptr;
+      const Output * output_data_ = nullptr;
+      size_t output_count_ = 0;
+      // the prefilter tables, which are computed from the transitions
+      bool has_prefilter_ = false;
+      std::array<uint8_t, 256> start_flags_;
+      std::array<std::array<uint8_t, 16>, 2> start_nibbles_;
+    };
+    
+    // builds the automaton from the terms of all expressions
+    void compile() {
+      Trie trie;
+      for (size_t query = 0; query < expressions_.size(); query++) {
+	for (auto term : compileExpression(query)) {
+	  auto & patterns = term->getPatterns();
+	  for (size_t i = 0; i < patterns.size(); i++) {
+	    auto id = term->hasWildcard() ? term->getFragmentId() + static_cast<uint32_t>(i) : term->getId();
+	    trie.addOutput(trie.addPattern(patterns[i].text), id, static_cast<uint32_t>(query));
+	  }
+	}
+      }
+      automaton_.compile(trie);
+    }
+
+    // Assigns ids to the terms of an expression, compiles its program and returns
+    // the terms for the automaton. Identical terms share an id and a pattern.
+    std::vector<Term *> compileExpression(size_t query) {
+      std::vector<Term *> all_terms, terms;
+      expressions_[query]->getTerms(all_terms);
+      std::unordered_map<std::string_view, Term *> unique_terms;
+      for (auto term : all_terms) {
+	if (unique_terms.emplace(term->getText(), term).second) terms.push_back(term);
+      }
+      programs_.emplace_back();
+      auto & program = programs_.back();
+      program.first_term = static_cast<uint32_t>(term_sizes_.size());
+      program.term_count = static_cast<uint32_t>(terms.size());
+      for (auto term : terms) {
+	term->setId(static_cast<uint32_t>(term_sizes_.size()));
+	term_sizes_.push_back(term->getSize());
+	fragment_ids_.push_back(NO_FRAGMENT);
+      }
+      // the fragments of wildcard terms get ids after the terms of the expression
+      for (auto term : terms) {
+	if (!term->hasWildcard()) continue;
+	auto & patterns = term->getPatterns();
+	term->setFragmentId(static_cast<uint32_t>(term_sizes_.size()));
+	for (size_t i = 0; i < patterns.size(); i++) {
+	  term_sizes_.push_back(patterns[i].size);
+	  fragment_ids_.push_back(static_cast<uint32_t>(fragments_.size()));
+	  fragments_.push_back(Fragment{ term->getId(), static_cast<uint32_t>(i), static_cast<uint32_t>(patterns.size() - 1), patterns[i].word_starts });
+	}
+      }
+      for (auto term : all_terms) {
+	auto first = unique_terms[term->getText()];
+	term->setId(first->getId());
+	term->setFragmentId(first->getFragmentId());
+      }
+      compileProgram(query);
+      if (query == 0) is_positional_ = expressions_.front()->isPositional();
+      has_fixed_operands_.push_back(expressions_[query]->hasFixedOperands());
+      if (has_fixed_operands_.back()) fixed_queries_.push_back(static_cast<uint32_t>(query));
+      return terms;
+    }
+
+    // compiles the program of an expression from its tree
+    void compileProgram(size_t query) {
+      auto & program = programs_[query];
+      program.code.clear();
+      program.nodes.clear();
+      program.depth = program.stack_size = 0;
+      program.truth_table = 0;
+      program.has_truth_table = false;
+      expressions_[query]->emit(program);
+      if (program.nodes.empty() && program.term_count <= 6 && program.depth <= 64) {
+	for (uint64_t hits = 0; hits < (uint64_t(1) << program.term_count); hits++) {
+	  auto value = run(program, [&](const Instruction & instruction) -> uint64_t {
+	    return (hits >> (instruction.arg - program.first_term)) & 1;
+	  });
+	  program.truth_table |= static_cast<uint64_t>(value) << hits;
+	}
+	program.has_truth_table = true;
+      }
+    }
+
+    // A read-only view of a file, which is memory mapped where supported
+    class MappedFile {
+    public:
+      explicit MappedFile(const std::string & filename) {
+#ifdef BOOLEAN_MATCHER_USE_MMAP
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd == -1) throw std::runtime_error("cannot open " + filename);
+	struct stat st;
+	if (::fstat(fd, &st) == -1) {
+	  ::close(fd);
+	  throw std::runtime_error("cannot open " + filename);
+	}
+	size_ = static_cast<size_t>(st.st_size);
+	void * data = size_ ? ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+	::close(fd);
+	if (data == MAP_FAILED) throw std::runtime_error("cannot map " + filename);
+	data_ = static_cast<const char *>(data);
+#else
+	std::ifstream in(filename, std::ios::binary | std::ios::ate);
+	if (!in) throw std::runtime_error("cannot open " + filename);
+	size_ = static_cast<size_t>(in.tellg());
+	// the buffer is aligned for the tables
+	buffer_.resize((size_ + 7) / 8);
+	in.seekg(0);
+	in.read(reinterpret_cast<char *>(buffer_.data()), static_cast<std::streamsize>(size_));
+	if (!in) throw std::runtime_error("cannot read " + filename);
+	data_ = reinterpret_cast<const char *>(buffer_.data());
+#endif
+      }
+      ~MappedFile() {
+#ifdef BOOLEAN_MATCHER_USE_MMAP
+	if (data_) ::munmap(const_cast<char *>(data_), size_);
+#endif
+      }
+      MappedFile(const MappedFile &) = delete;
+      MappedFile & operator=(const MappedFile &) = delete;
+
+      const char * data() const noexcept { return data_; }
+      size_t size() const noexcept { return size_; }
+
+    private:
+      const char * data_ = nullptr;
+      size_t size_ = 0;
+#ifndef BOOLEAN_MATCHER_USE_MMAP
+      std::vector<uint64_t> buffer_;
+#endif
+    };
+
+    // creates a query from a saved file
+    explicit basic_compiled_query(std::shared_ptr<const MappedFile> file) : file_(std::move(file)) {
+      auto data = file_->data();
+      auto size = file_->size();
+      FileHeader header;
+      if (size < sizeof(header)) throw std::runtime_error("invalid query file");
+      std::memcpy(&header, data, sizeof(header));
+      if (std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0 || header.byte_order != BYTE_ORDER_MARK) {
+	throw std::runtime_error("invalid query file");
+      }
+      if (header.version != FILE_VERSION) throw std::runtime_error("unsupported query file version");
+      if (header.tokenizer != Tokenizer::ID) throw std::runtime_error("query file has a different tokenizer");
+
+      // returns a section of the file after checking that it is within the file
+      auto getSection = [&](uint64_t offset, uint64_t count, size_t element_size) {
+	if (offset > size || count > (size - offset) / element_size || offset % alignof(uint64_t) != 0) {
+	  throw std::runtime_error("invalid query file");
+	}
+	return data + offset;
+      };
+
+      auto p = getSection(header.expressions_offset, header.expressions_size, 1);
+      auto end = p + header.expressions_size;
+      for (uint64_t query = 0; query < header.expression_count; query++) {
+	auto record_size = readValue<uint32_t>(p, end);
+	if (record_size > static_cast<size_t>(end - p)) throw std::runtime_error("invalid query file");
+	expressions_.push_back(readExpression(p, p + record_size));
+	p += record_size;
+	std::vector<Term *> terms;
+	expressions_.back()->getTerms(terms);
+	std::vector<uint32_t> saved_ids;
+	for (auto term : terms) saved_ids.push_back(term->getId());
+	compileExpression(query);
+	for (size_t i = 0; i < terms.size(); i++) {
+	  if (terms[i]->getId() != saved_ids[i]) throw std::runtime_error("invalid query file");
+	}
+      }
+      if (term_sizes_.size() != header.term_count) throw std::runtime_error("invalid query file");
+
+      auto transitions = getSection(header.transitions_offset, header.transition_count, sizeof(uint32_t));
+      auto outputs = getSection(header.outputs_offset, header.output_count, sizeof(Output));
+      automaton_.map(header, reinterpret_cast<const uint32_t *>(transitions), reinterpret_cast<const Output *>(outputs));
+
+      // the term ids of the automaton must belong to the expressions they are reported for
+      auto [ output, outputs_end ] = automaton_.getOutputs();
+      for (; output != outputs_end; output++) {
+	if (output->query >= programs_.size() || output->term < programs_[output->query].first_term ||
+	    output->term >= (output->query + 1 < programs_.size() ? programs_[output->query + 1].first_term : term_sizes_.size())) {
+	  throw std::runtime_error("invalid query file");
+	}
+      }
+    }
+
+    // creates an expression tree from postfix records
+    static std::unique_ptr<Node> readExpression(const char * p, const char * end) {
+      std::vector<std::unique_ptr<Node>> node_stack;
+      while (p < end) {
+	auto type = readValue<NodeType>(p, end);
+	switch (type) {
+	case NodeType::TERM:
+	  {
+	    // the saved id is checked against the id that the term gets when compiled
+	    auto id = readValue<uint32_t>(p, end);
+	    auto term_size = readValue<uint32_t>(p, end);
+	    if (term_size > static_cast<size_t>(end - p)) throw std::runtime_error("invalid query file");
+	    auto term = std::make_unique<Term>(std::string(p, term_size));
+	    term->setId(id);
+	    node_stack.push_back(std::move(term));
+	    p += term_size;
+	  }
+	  break;
+	case NodeType::AND:
+	  node_stack.push_back(std::make_unique<And>(node_stack));
+	  break;
+	case NodeType::OR:
+	  node_stack.push_back(std::make_unique<Or>(node_stack));
+	  break;
+	case NodeType::AND_NOT:
+	  node_stack.push_back(std::make_unique<AndNot>(node_stack));
+	  break;
+	case NodeType::NEAR:
+	  {
+	    auto left_distance = readValue<int32_t>(p, end);
+	    auto right_distance = readValue<int32_t>(p, end);
+	    node_stack.push_back(std::make_unique<Near>(node_stack, left_distance, right_distance));
+	  }
+	  break;
+	case NodeType::CONSTANT:
+	  node_stack.push_back(std::make_unique<Constant>(readValue<uint8_t>(p, end) != 0));
+	  break;
+	case NodeType::PREDICATE:
+	  {
+	    auto predicate_size = readValue<uint32_t>(p, end);
+	    if (predicate_size > static_cast<size_t>(end - p)) throw std::runtime_error("invalid query file");
+	    std::string_view predicate(p, predicate_size);
+	    size_t pos = 0;
+	    auto node = parsePredicate(predicate, 0, pos);
+	    if (!node || pos != predicate.size()) throw std::runtime_error("invalid query file");
+	    node_stack.push_back(std::move(node));
+	    p += predicate_size;
+	  }
+	  break;
+	default:
+	  throw std::runtime_error("invalid query file");
+	}
+      }
+      if (node_stack.size() != 1) throw std::runtime_error("invalid query file");
+      // the operators are stored as binary records
+      return optimize(std::move(node_stack.back()));
+    }
+
+    template<typename T>
+    static void appendValue(std::string & r, T value) {
+      r.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    // appends an array aligned to 8 bytes and returns its offset
+    template<typename T>
+    static uint64_t appendArray(std::string & r, const T * data, size_t count) {
+      r.resize((r.size() + 7) / 8 * 8, '\0');
+      auto offset = r.size();
+      r.append(reinterpret_cast<const char *>(data), count * sizeof(T));
+      return offset;
+    }
+
+    template<typename T>
+    static T readValue(const char *& p, const char * end) {
+      T value;
+      if (static_cast<size_t>(end - p) < sizeof(value)) throw std::runtime_error("invalid query file");
+      std::memcpy(&value, p, sizeof(value));
+      p += sizeof(value);
+      return value;
+    }
+
+    // evaluates the first expression
+    bool eval(const scan_context & context) const {
+      return !expressions_.empty() && evalExpression(0, context);
+    }
+
+    // evaluates an expression with its truth table or program if possible
+    bool evalExpression(size_t query, const scan_context & context) const {
+      auto & program = programs_[query];
+      if (program.has_truth_table) {
+	return (program.truth_table >> getBits(context.term_hits_, program.first_term, program.term_count)) & 1;
+      } else if (program.depth <= 64) {
+	return run(program, [&](const Instruction & instruction) -> uint64_t {
+	  if (instruction.op == Opcode::TERM) return (context.term_hits_[instruction.arg >> 6] >> (instruction.arg & 63)) & 1;
+	  return program.nodes[instruction.arg]->eval(context);
+	});
+      } else {
+	return expressions_[query]->eval(context);
+      }
+    }
+
+    // runs a program whose stack depth is at most 64. The stack is kept in the
+    // bits of a single word with the top of the stack in the lowest bit.
+    template<typename F>
+    static bool run(const Program & program, F && get_value) {
+      uint64_t stack = 0;
+      for (auto & instruction : program.code) {
+	switch (instruction.op) {
+	case Opcode::TERM:
+	case Opcode::NODE:
+	  stack = (stack << 1) | get_value(instruction);
+	  break;
+	case Opcode::AND:
+	  stack = ((stack >> 2) << 1) | ((stack >> 1) & stack & 1);
+	  break;
+	case Opcode::OR:
+	  stack = ((stack >> 2) << 1) | (((stack >> 1) | stack) & 1);
+	  break;
+	case Opcode::AND_NOT:
+	  stack = ((stack >> 2) << 1) | ((stack >> 1) & ~stack & 1);
+	  break;
+	}
+      }
+      return stack & 1;
+    }
+
+    // returns count bits starting at bit first of a bitset, where count is at most 6
+    static uint64_t getBits(const std::vector<uint64_t> & bits, uint32_t first, uint32_t count) noexcept {
+      auto shift = first & 63;
+      auto value = bits[first >> 6] >> shift;
+      if (shift + count > 64) value |= bits[(first >> 6) + 1] << (64 - shift);
+      return value & ((uint64_t(1) << count) - 1);
+    }
+
+    // starts a new text with a metadata record, which may be nullptr
+    void start(scan_context & context, const metadata * record) const {
+      initialize(context);
+      context.metadata_ = record;
+      if constexpr (PROFILING) context.statistics_.texts_++;
+    }
+
+    // returns the outcome of an expression before the text is scanned, which is
+    // decided only if the expression has metadata predicates or constants
+    Outcome decide(size_t query, const scan_context & context) const {
+      if (query >= has_fixed_operands_.size() || !has_fixed_operands_[query]) return Outcome::UNDECIDED;
+      return expressions_[query]->getOutcome(context);
+    }
+
+    // runs the automaton over a complete text
+    void scan(std::string_view text, scan_context & context, std::vector<Offset> * offsets = nullptr) const {
+      normalize(text, context, offsets);
+      Stopwatch stopwatch(context.statistics_.scan_ns_);
+      updateState(context.text_, context);
+      finishState(context);
+    }
+
+    // A part of a text that is scanned in parallel. The input is split at
+    // normalization boundaries, so that the normalized chunks can be joined.
+    struct Chunk {
+      std::string_view input;
+      std::string text;
+      std::vector<Offset> offsets;
+      bool is_valid = true;
+      // the start and the end of the chunk in the normalized text
+      size_t begin = 0, end = 0;
+      std::vector<ChunkMatch> matches;
+      // the number of words that start in the chunk
+      int words = 0;
+    };
+
+    // Normalizes and scans a text in parallel chunks, and adds the matches to a
+    // context in the order of the text, so that the matches are the same as with
+    // scan(). If offsets is given, it receives the map from the normalized text
+    // to the input.
+    void scanParallel(std::string_view text, scan_context & context, thread_pool & pool, size_t chunk_size, std::vector<Offset> * offsets) const {
+      if constexpr (PROFILING) context.statistics_.bytes_ += text.size();
+      std::vector<Chunk> chunks;
+      for (size_t begin = 0; begin < text.size(); ) {
+	// a chunk without a normalization boundary grows until it has one
+	auto size = std::max<size_t>(chunk_size, 1);
+	size_t boundary = 0;
+	while (begin + size < text.size() && !(boundary = findChunkBoundary(text.substr(begin, size)))) size *= 2;
+	auto end = begin + size < text.size() ? begin + boundary : text.size();
+	chunks.emplace_back();
+	chunks.back().input = text.substr(begin, end - begin);
+	begin = end;
+      }
+
+      {
+	Stopwatch stopwatch(context.statistics_.normalize_ns_);
+	pool.for_each(chunks.size(), [&](size_t i, scan_context & worker_context) {
+	  auto & chunk = chunks[i];
+	  chunk.is_valid = normalize(chunk.input, chunk.text, worker_context.buffer_, offsets ? &chunk.offsets : nullptr);
+	});
+	// invalid UTF-8 anywhere in the text empties the whole text as in normalize()
+	bool is_valid = std::all_of(chunks.begin(), chunks.end(), [](auto & chunk) { return chunk.is_valid; });
+	size_t size = 0;
+	for (auto & chunk : chunks) {
+	  if (!is_valid) chunk.text.clear();
+	  chunk.begin = size;
+	  size += chunk.text.size();
+	  chunk.end = size;
+	}
+	if (offsets) {
+	  offsets->clear();
+	  size_t original = 0;
+	  for (auto & chunk : chunks) {
+	    // the last segment of each chunk marks its end
+	    for (size_t i = 0; is_valid && i + 1 < chunk.offsets.size(); i++) {
+	      auto & offset = chunk.offsets[i];
+	      addOffset(offsets, chunk.begin + static_cast<size_t>(offset.normalized), original + static_cast<size_t>(offset.original), offset.is_exact);
+	    }
+	    original += chunk.input.size();
+	  }
+	  offsets->push_back(Offset{ static_cast<int>(size), static_cast<int>(text.size()), true });
+	}
+	context.text_.resize(size);
+	pool.for_each(chunks.size(), [&](size_t i, scan_context &) {
+	  auto & chunk = chunks[i];
+	  std::copy(chunk.text.begin(), chunk.text.end(), context.text_.begin() + static_cast<std::ptrdiff_t>(chunk.begin));
+	  std::string().swap(chunk.text);
+	});
+      }
+
+      std::string_view s = context.text_;
+      {
+	Stopwatch stopwatch(context.statistics_.scan_ns_);
+	// the automaton is in the same state after as many bytes as its deepest
+	// state has symbols, and a pattern has at most one boundary per byte and one more
+	auto overlap = 2 * static_cast<size_t>(term_sizes_.empty() ? 0 : *std::max_element(term_sizes_.begin(), term_sizes_.end())) + 1;
+	pool.for_each(chunks.size(), [&](size_t i, scan_context & worker_context) {
+	  auto & chunk = chunks[i];
+	  chunk.words = scanChunk(s, chunk.begin, chunk.end, i + 1 == chunks.size(), overlap, chunk.matches, worker_context);
+	});
+      }
+
+      // the word indexes of the chunks are shifted by the words of the previous chunks
+      int words = 0;
+      for (auto & chunk : chunks) {
+	for (auto & match : chunk.matches) {
+	  context.current_word_ = words + match.word;
+	  addMatch(match.term, match.query, match.pos, context);
+	}
+	words += chunk.words;
+      }
+      context.current_word_ = words;
+      context.current_pos_ = static_cast<int>(s.size());
+      context.prev_class_ = word_class::NON_WORD;
+    }
+
+    // Scans the part [begin, end) of a normalized text with a worker context,
+    // records its matches and returns the number of words that start in it. The
+    // automaton and the word class are first brought to their state at begin by
+    // running over overlap bytes before it without reporting matches.
+    int scanChunk(std::string_view s, size_t begin, size_t end, bool is_last, size_t overlap, std::vector<ChunkMatch> & matches, scan_context & context) const {
+      initialize(context);
+      auto i = begin > overlap ? begin - overlap : 0;
+      while (i > 0 && (static_cast<unsigned char>(s[i]) & 0xc0) == 0x80) i--;
+      while (i < begin) {
+	char32_t codepoint;
+	auto n = decodeCodepoint(s, i, codepoint);
+	auto cls = getWordClass(codepoint);
+	if (isBoundary(context.prev_class_, cls)) context.current_state_ = automaton_.getTransition(context.current_state_, BOUNDARY);
+	context.prev_class_ = cls;
+	for (auto next = i + n; i < next; i++) context.current_state_ = automaton_.getTransition(context.current_state_, s[i]);
+      }
+      context.current_pos_ = static_cast<int>(begin);
+      context.chunk_matches_ = &matches;
+      updateState(s.substr(begin, end - begin), context);
+      if (is_last) finishState(context);
+      context.chunk_matches_ = nullptr;
+      return context.current_word_;
+    }
+
+    // normalizes a text into the buffer of a context, and builds the offset map if requested
+    static void normalize(std::string_view text, scan_context & context, std::vector<Offset> * offsets = nullptr) noexcept {
+      Stopwatch stopwatch(context.statistics_.normalize_ns_);
+      if constexpr (PROFILING) context.statistics_.bytes_ += text.size();
+      normalize(text, context.text_, context.buffer_, offsets);
+    }
+
+    // adds the lifetime of the object to a counter when profiling is enabled
+    class Stopwatch {
+    public:
+      explicit Stopwatch(uint64_t & counter) noexcept : counter_(counter) {
+	if constexpr (PROFILING) t0_ = std::chrono::steady_clock::now();
+      }
+      ~Stopwatch() {
+	if constexpr (PROFILING) {
+	  counter_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0_).count());
+	}
+      }
+      Stopwatch(const Stopwatch &) = delete;
+      Stopwatch & operator=(const Stopwatch &) = delete;
+
+    private:
+      uint64_t & counter_;
+      std::chrono::steady_clock::time_point t0_;
+    };
+
+    void initialize(scan_context & context) const {
+      // reset the matches of the previous text
+      for (auto term : context.matched_terms_) {
+	context.matches_[term].clear();
+	context.term_hits_[term >> 6] &= ~(uint64_t(1) << (term & 63));
+      }
+      context.matched_terms_.clear();
+      for (auto query : context.hits_) {
+	context.is_hit_[query] = false;
+      }
+      context.hits_.clear();
+      for (auto fragment : context.chained_fragments_) {
+	context.chains_[fragment].start = -1;
+      }
+      context.chained_fragments_.clear();
+      // the context may have been used with another query
+      context.matches_.resize(term_sizes_.size());
+      context.chains_.resize(fragments_.size());
+      context.term_hits_.resize((term_sizes_.size() + 63) / 64);
+      context.is_hit_.resize(expressions_.size());
+      
+      context.current_pos_ = 0;
+      context.current_word_ = 0;
+      context.prev_class_ = word_class::NON_WORD;
+      context.stop_early_ = context.is_decided_ = false;
+      context.match_count_ = 0;
+      context.next_check_ = 1;
+      context.chunk_matches_ = nullptr;
+      context.current_state_ = automaton_.getRoot();
+    }
+
+    // processes a normalized UTF-8 string. Codepoints are decoded inline only to
+    // find the word boundaries, and the automaton is run over the bytes.
+    void updateState(std::string_view s, scan_context & context) const {
+      for (size_t i = 0; i < s.size() && !context.is_decided_; ) {
+	if (context.current_state_ == automaton_.getRoot() && automaton_.hasPrefilter()) {
+	  i = skipText(s, i, context);
+	  if (i == s.size()) break;
+	}
+	char32_t codepoint;
+	auto n = decodeCodepoint(s, i, codepoint);
+	auto cls = getWordClass(codepoint);
+	if constexpr (PROFILING) context.statistics_.codepoints_++;
+	if (isBoundary(context.prev_class_, cls)) {
+	  updateState(BOUNDARY, context);
+	  if (cls != word_class::NON_WORD) context.current_word_++;
+	}
+	context.prev_class_ = cls;
+
+	for (auto end = i + n; i < end; i++) updateState(s[i], context);
+      }
+    }
+
+    // Processes a normalized UTF-16 or UTF-32 string in place. Each codepoint is
+    // encoded as UTF-8 for the automaton, so the match positions are byte offsets
+    // in the UTF-8 form of the text. Codepoints that cannot move the automaton
+    // away from the root are skipped as in skipText().
+    template<typename Char>
+    void scanCodeUnits(std::basic_string_view<Char> s, scan_context & context) const {
+      for (size_t i = 0; i < s.size() && !context.is_decided_; ) {
+#ifdef __SSSE3__
+	__m128i v;
+	if (context.current_state_ == automaton_.getRoot() && automaton_.hasPrefilter() && i + 16 <= s.size() && loadAscii(s.data() + i, v)) {
+	  auto n = skipAsciiBlock(v, context);
+	  i += n;
+	  if constexpr (PROFILING) context.statistics_.skipped_bytes_ += n;
+	  if (n == 16) continue;
+	}
+#endif
+	char32_t codepoint;
+	i += decodeCodeUnits(s, i, codepoint);
+	char bytes[4];
+	auto n = encodeCodepoint(codepoint, bytes);
+	auto cls = getWordClass(codepoint);
+	auto is_boundary = isBoundary(context.prev_class_, cls);
+	if constexpr (PROFILING) context.statistics_.codepoints_++;
+	if (context.current_state_ == automaton_.getRoot() && automaton_.hasPrefilter()) {
+	  uint8_t flags = 0;
+	  for (size_t k = 0; k < n; k++) flags |= automaton_.getStartFlags(bytes[k]);
+	  if (!(flags & START) && !((flags & START_AFTER_BOUNDARY) && is_boundary)) {
+	    if (is_boundary && cls != word_class::NON_WORD) context.current_word_++;
+	    context.prev_class_ = cls;
+	    context.current_pos_ += static_cast<int>(n);
+	    if constexpr (PROFILING) context.statistics_.skipped_bytes_ += n;
+	    continue;
+	  }
+	}
+	if (is_boundary) {
+	  updateState(BOUNDARY, context);
+	  if (cls != word_class::NON_WORD) context.current_word_++;
+	}
+	context.prev_class_ = cls;
+	for (size_t k = 0; k < n; k++) updateState(bytes[k], context);
+      }
+    }
+
+    // Skips the codepoints from position i on that cannot move the automaton away
+    // from the root and returns the position of the next candidate. The byte
+    // position and the word index are updated as if the automaton had been run
+    // over the skipped text. Blocks of ASCII are classified 16 bytes at a time.
+    size_t skipText(std::string_view s, size_t i, scan_context & context) const noexcept {
+      auto start = i;
+#ifdef __SSSE3__
+      // blocks with non-ASCII bytes are processed one codepoint at a time up to scalar_end
+      size_t scalar_end = i;
+#endif
+      while (i < s.size()) {
+#ifdef __SSSE3__
+	if (i >= scalar_end && i + 16 <= s.size()) {
+	  auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s.data() + i));
+	  if (_mm_movemask_epi8(v)) {
+	    scalar_end = i + 16;
+	  } else {
+	    auto n = skipAsciiBlock(v, context);
+	    i += n;
+	    if (n < 16) break;
+	    continue;
+	  }
+	}
+#endif
+	char32_t codepoint;
+	auto n = decodeCodepoint(s, i, codepoint);
+	auto cls = getWordClass(codepoint);
+	auto is_boundary = isBoundary(context.prev_class_, cls);
+	uint8_t flags = 0;
+	for (size_t k = 0; k < n; k++) flags |= automaton_.getStartFlags(s[i + k]);
+	if ((flags & START) || ((flags & START_AFTER_BOUNDARY) && is_boundary)) break;
+	if (is_boundary && cls != word_class::NON_WORD) context.current_word_++;
+	context.prev_class_ = cls;
+	context.current_pos_ += static_cast<int>(n);
+	i += n;
+	if constexpr (PROFILING) context.statistics_.codepoints_++;
+      }
+      if constexpr (PROFILING) context.statistics_.skipped_bytes_ += i - start;
+      return i;
+    }
+
+#ifdef __SSSE3__
+    // Skips the characters at the start of a block of 16 ASCII characters that
+    // cannot move the automaton away from the root, and returns their number.
+    // The context is updated as if the characters had been scanned.
+    uint32_t skipAsciiBlock(__m128i v, scan_context & context) const noexcept {
+      auto word = static_cast<uint32_t>(_mm_movemask_epi8(getAsciiWordMask(v)));
+      auto boundary = (word ^ ((word << 1) | static_cast<uint32_t>(context.prev_class_ == word_class::WORD))) & 0xffff;
+      if (context.prev_class_ == word_class::SINGLE) boundary |= 1;
+      auto candidates = findStartBytes(v, START) | (findStartBytes(v, START_AFTER_BOUNDARY) & boundary);
+      auto n = candidates ? static_cast<uint32_t>(__builtin_ctz(candidates)) : 16u;
+      auto skipped = (uint32_t(1) << n) - 1;
+      context.current_word_ += __builtin_popcount(boundary & word & skipped);
+      if (n > 0) context.prev_class_ = (word >> (n - 1)) & 1 ? word_class::WORD : word_class::NON_WORD;
+      context.current_pos_ += static_cast<int>(n);
+      if constexpr (PROFILING) context.statistics_.codepoints_ += n;
+      return n;
+    }
+
+    // loads 16 UTF-16 or UTF-32 code units as bytes, if they are all ASCII
+    template<typename Char>
+    static bool loadAscii(const Char * p, __m128i & v) noexcept {
+      auto load = [&](size_t offset) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + offset)); };
+      if constexpr (sizeof(Char) == 2) {
+	auto a = load(0), b = load(8);
+	auto is_ascii = _mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16(-0x80)), _mm_setzero_si128());
+	if (_mm_movemask_epi8(is_ascii) != 0xffff) return false;
+	v = _mm_packus_epi16(a, b);
+      } else {
+	auto a = load(0), b = load(4), c = load(8), d = load(12);
+	auto all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+	auto is_ascii = _mm_cmpeq_epi32(_mm_and_si128(all, _mm_set1_epi32(-0x80)), _mm_setzero_si128());
+	if (_mm_movemask_epi8(is_ascii) != 0xffff) return false;
+	v = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+      }
+      return true;
+    }
+
+    // returns a mask of the ASCII word characters in a block
+    static __m128i getAsciiWordMask(__m128i v) noexcept {
+      auto inRange = [&](char first, char last) {
+	return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(first - 1))), _mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(last + 1))));
+      };
+      auto letters = _mm_or_si128(inRange('a', 'z'), inRange('A', 'Z'));
+      return _mm_or_si128(_mm_or_si128(letters, inRange('0', '9')), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    }
+
+    // returns a bitmask of the bytes of an ASCII block that have a start flag
+    uint32_t findStartBytes(__m128i v, uint8_t flag) const noexcept {
+      return findStartBytes(v, automaton_.getStartNibbles(flag));
+    }
+
+    // returns a bitmask of the bytes of an ASCII block that are in a set of bytes,
+    // given as the bits of the high nibbles of the bytes for each low nibble
+    static uint32_t findStartBytes(__m128i v, const std::array<uint8_t, 16> & nibbles) noexcept {
+      auto table = _mm_loadu_si128(reinterpret_cast<const __m128i *>(nibbles.data()));
+      auto high_bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+      auto low = _mm_shuffle_epi8(table, _mm_and_si128(v, _mm_set1_epi8(0x0f)));
+      auto high = _mm_shuffle_epi8(high_bits, _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f)));
+      auto misses = _mm_cmpeq_epi8(_mm_and_si128(low, high), _mm_setzero_si128());
+      return static_cast<uint32_t>(_mm_movemask_epi8(misses)) ^ 0xffff;
+    }
+#endif
+
+    // ends the last word of the text
+    void finishState(scan_context & context) const {
+      if (context.prev_class_ != word_class::NON_WORD) {
+	updateState(BOUNDARY, context);
+	context.prev_class_ = word_class::NON_WORD;
+      }
+    }
+    
+    // processes a single byte. A boundary is reported at the position of the previous byte.
+    void updateState(char character, scan_context & context) const {
+      auto pos = character == BOUNDARY ? context.current_pos_ - 1 : context.current_pos_++;
+
+      context.current_state_ = automaton_.getTransition(context.current_state_, character);
+      
+      if (!automaton_.hasOutput(context.current_state_)) return;
+      for (auto state = context.current_state_; state != automaton_.getRoot(); state = automaton_.getOutputLink(state)) {
+	auto [ begin, end ] = automaton_.getOutput(state);
+	for (auto output = begin; output != end; ++output) {
+	  auto match_pos = pos - term_sizes_[output->term] + 1;
+	  if (context.chunk_matches_) {
+	    context.chunk_matches_->push_back(ChunkMatch{ output->term, output->query, match_pos, context.current_word_ });
+	  } else {
+	    addMatch(output->term, output->query, match_pos, context);
+	  }
+	}
+      }
+    }
+
+    // adds a match of a pattern that ends in the current word
+    void addMatch(uint32_t term, uint32_t query, int match_pos, scan_context & context) const {
+      auto size = term_sizes_[term];
+      if (fragment_ids_[term] != NO_FRAGMENT) {
+	if (!joinFragment(fragment_ids_[term], match_pos, size, context)) return;
+	term = fragments_[fragment_ids_[term]].term;
+      }
+      auto & matches = context.matches_[term];
+      bool is_first = matches.empty();
+      if (is_first) {
+	context.matched_terms_.push_back(term);
+	context.term_hits_[term >> 6] |= uint64_t(1) << (term & 63);
+      }
+      matches.emplace_back(match_pos, size, context.current_word_);
+      if constexpr (PROFILING) context.statistics_.term_matches_++;
+      // Only the first match of a term can decide a non-positional expression.
+      // A positional expression merges all the match lists when evaluated, so it
+      // is evaluated again only after the number of matches has doubled.
+      bool check = is_first;
+      if (is_positional_ && ++context.match_count_ == context.next_check_) {
+	context.next_check_ *= 2;
+	check = true;
+      }
+      if (context.stop_early_ && check) {
+	context.is_decided_ = expressions_.front()->getOutcome(context) != Outcome::UNDECIDED;
+      }
+      if (!context.is_hit_[query]) {
+	context.is_hit_[query] = true;
+	context.hits_.push_back(query);
+      }
+    }
+
+    // Adds a match of a wildcard fragment to the partial matches of its term and
+    // returns true if it completes a match, which is then returned in pos and
+    // size. The fragments must follow each other within a word. Only the first
+    // fragment match that extends the earliest partial match is kept, so each
+    // fragment match is looked at once.
+    bool joinFragment(uint32_t id, int & pos, int & size, scan_context & context) const {
+      auto & fragment = fragments_[id];
+      auto & chain = context.chains_[id];
+      auto start = pos, end = pos + size;
+      auto word = context.current_word_;
+      if (fragment.index == 0) {
+	// a match cannot overlap the previous match of the term
+	auto & last = context.chains_[id + fragment.last_index];
+	if (last.start >= 0 && start < last.end) return false;
+	if (chain.start >= 0 && chain.word == word) return false;
+      } else {
+	auto & prev = context.chains_[id - 1];
+	if (prev.start < 0 || prev.end > start || prev.word != word - fragment.word_starts || chain.start == prev.start) return false;
+	start = prev.start;
+      }
+      if (chain.start < 0) context.chained_fragments_.push_back(id);
+      chain.start = start;
+      chain.end = end;
+      chain.word = word;
+      if (fragment.index < fragment.last_index) return false;
+
+      // the next match of the term starts from the first fragment
+      for (auto i = id - fragment.index; i < id; i++) context.chains_[i].start = -1;
+      pos = start;
+      size = end - start;
+      return true;
+    }
+
+    // normalizes a string
+    static std::string normalize(std::string_view input) noexcept {
+      std::string r;
+      std::vector<utf8proc_int32_t> buffer;
+      normalize(input, r, buffer);
+      return r;
+    }
+
+    // normalizes a string into output reusing the storage of output and buffer.
+    // ASCII runs are case folded inline and only the non-ASCII spans are passed to
+    // utf8proc, which gives the same result as a single utf8proc_map call. If
+    // offsets is given, it receives the map from the output to the input. Returns
+    // false if the input is not valid UTF-8, and then the output is empty.
+    static bool normalize(std::string_view input, std::string & output, std::vector<utf8proc_int32_t> & buffer, std::vector<Offset> * offsets = nullptr) noexcept {
+      output.clear();
+      if (offsets) offsets->clear();
+      bool is_valid = true;
+      size_t i = 0;
+      while (i < input.size()) {
+	auto j = findNonAscii(input, i);
+	auto k = j;
+	if (j < input.size()) {
+	  // the starter before a non-ASCII span may be composed with it, and stripped
+	  // control characters in between do not prevent that
+	  while (k > i && isStrippedControl(input[k - 1])) k--;
+	  if (k > i) k--;
+	  if (k > i && input[k - 1] == '\r' && input[k] == '\n') k--;
+	}
+	foldAscii(input.substr(i, k - i), output, offsets, i);
+	if (k == input.size()) break;
+
+	// the span ends before an ASCII character that is not stripped, since
+	// it cannot be composed with the preceding characters. LF is kept in the
+	// span, because it forms a single newline with a CR before ignored characters.
+	i = j;
+	while (i < input.size() && (static_cast<unsigned char>(input[i]) >= 0x80 || isStrippedControl(input[i]) || input[i] == '\n')) i++;
+	if (offsets ? !normalizeSpan(input.substr(k, i - k), output, buffer, *offsets, k) : !normalizeSpan(input.substr(k, i - k), output, buffer)) {
+	  output.clear();
+	  if (offsets) offsets->clear();
+	  is_valid = false;
+	  break;
+	}
+      }
+      // the end of the text
+      if (offsets) offsets->push_back(Offset{ static_cast<int>(output.size()), static_cast<int>(input.size()), true });
+      return is_valid;
+    }
+
+    // returns true if a text can be split before codepoint without changing its
+    // normalization: the codepoint is a starter that is never the second character
+    // of a composition, and it is not removed or merged with its neighbours
+    static bool isNormalizationBoundary(char32_t codepoint) noexcept {
+      if (codepoint < 0x80) return codepoint >= 0x20 && codepoint < 0x7f;
+      // Hangul vowels and trailing consonants compose with the preceding syllable
+      if (codepoint >= 0x1160 && codepoint < 0x1200) return false;
+      auto property = utf8proc_get_property(static_cast<utf8proc_int32_t>(codepoint));
+      auto cat = property->category;
+      return property->combining_class == 0 && !property->ignorable && cat != UTF8PROC_CATEGORY_MN && cat != UTF8PROC_CATEGORY_MC && cat != UTF8PROC_CATEGORY_ME && cat != UTF8PROC_CATEGORY_CC && cat != UTF8PROC_CATEGORY_CF;
+    }
+
+    // returns the position of the last normalization boundary in s, or zero if there is none
+    static size_t findNormalizationBoundary(std::string_view s) noexcept {
+      for (auto i = s.size(); i-- > 0; ) {
+	if ((static_cast<unsigned char>(s[i]) & 0xc0) == 0x80) continue;
+	utf8proc_int32_t codepoint;
+	auto n = utf8proc_iterate(reinterpret_cast<const utf8proc_uint8_t *>(s.data() + i), static_cast<utf8proc_ssize_t>(s.size() - i), &codepoint);
+	if (n > 0 && isNormalizationBoundary(static_cast<char32_t>(codepoint))) return i;
+      }
+      return 0;
+    }
+
+    // Returns the position of the last normalization boundary in s where a text can
+    // be split for parallel normalization, or zero if there is none. normalize()
+    // joins the character and the control characters before a non-ASCII span into
+    // a single segment of the offset map, so a split must not separate them.
+    static size_t findChunkBoundary(std::string_view s) noexcept {
+      for (auto i = findNormalizationBoundary(s); i > 0; i = findNormalizationBoundary(s.substr(0, i))) {
+	auto prev = static_cast<unsigned char>(s[i - 1]);
+	if (static_cast<unsigned char>(s[i]) < 0x80 || (prev >= 0x20 && prev != 0x7f)) return i;
+      }
+      return 0;
+    }
+
+    // returns true if c is an ASCII control character that is removed by normalization
+    static bool isStrippedControl(char c) noexcept {
+      return (c >= 0 && c < 0x20 && c != '\t' && c != '\n' && c != '\v' && c != '\f' && c != '\r') || c == 0x7f;
+    }
+
+    // returns the position of the first non-ASCII byte at or after i
+    static size_t findNonAscii(std::string_view input, size_t i) noexcept {
+#ifdef __SSE2__
+      for (; i + 16 <= input.size(); i += 16) {
+	auto mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input.data() + i)));
+	if (mask) return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned int>(mask)));
+      }
+#endif
+      while (i < input.size() && static_cast<unsigned char>(input[i]) < 0x80) i++;
+      return i;
+    }
+
+    // case folds an ASCII string and replaces or strips the control characters
+    static void foldAscii(std::string_view input, std::string & output, std::vector<Offset> * offsets = nullptr, size_t original = 0) {
+      auto pos = output.size();
+      addOffset(offsets, pos, original, true);
+      output.resize(pos + input.size());
+      auto out = &output[pos];
+      size_t i = 0;
+#ifdef __SSE2__
+      // blocks of printable characters only need the upper case letters folded
+      for (; i + 16 <= input.size(); i += 16) {
+	auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input.data() + i));
+	auto special = _mm_or_si128(_mm_cmplt_epi8(v, _mm_set1_epi8(0x20)), _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f)));
+	if (_mm_movemask_epi8(special)) break;
+	auto upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+	out += 16;
+      }
+#endif
+      for (; i < input.size(); i++) {
+	auto c = input[i];
+	if (c >= 'A' && c <= 'Z') {
+	  *out++ = static_cast<char>(c + 0x20);
+	} else if (c >= 0x20 && c != 0x7f) {
+	  *out++ = c;
+	} else if (c == '\r') {
+	  // CR LF is a single newline
+	  if (i + 1 < input.size() && input[i + 1] == '\n') i++;
+	  *out++ = ' ';
+	  addOffset(offsets, static_cast<size_t>(out - output.data()), original + i + 1, true);
+	} else if (c == '\t' || c == '\n' || c == '\v' || c == '\f') {
+	  *out++ = ' ';
+	} else {
+	  addOffset(offsets, static_cast<size_t>(out - output.data()), original + i + 1, true);
+	}
+      }
+      output.resize(static_cast<size_t>(out - output.data()));
+    }
+
+    // Normalizes a span piece by piece, and appends it to output and the pieces
+    // to offsets. The pieces are split at normalization boundaries, which does
+    // not change the result. A piece is exact if it is a single codepoint whose
+    // size does not change, so that runs of such pieces need a single offset.
+    static bool normalizeSpan(std::string_view input, std::string & output, std::vector<utf8proc_int32_t> & buffer, std::vector<Offset> & offsets, size_t original) noexcept {
+      auto isCodepoint = [](std::string_view s) {
+	char32_t codepoint;
+	return !s.empty() && decodeCodepoint(s, 0, codepoint) == s.size();
+      };
+      // a span that is already normalized is a single exact segment when each of
+      // its codepoints is a piece of its own, which is the common case
+      auto pos0 = output.size();
+      if (!normalizeSpan(input, output, buffer)) return false;
+      if (std::string_view(output).substr(pos0) == input) {
+	size_t i = 0;
+	char32_t codepoint;
+	while (i < input.size()) {
+	  auto n = decodeCodepoint(input, i, codepoint);
+	  if (!isNormalizationBoundary(codepoint)) break;
+	  i += n;
+	}
+	if (i == input.size()) {
+	  addOffset(&offsets, pos0, original, true);
+	  return true;
+	}
+      }
+      output.resize(pos0);
+      size_t start = 0;
+      for (size_t i = 0; i <= input.size(); ) {
+	char32_t codepoint = 0;
+	auto n = i < input.size() ? decodeCodepoint(input, i, codepoint) : 1;
+	if (i > start && (i == input.size() || isNormalizationBoundary(codepoint))) {
+	  auto piece = input.substr(start, i - start);
+	  auto pos = output.size();
+	  if (!normalizeSpan(piece, output, buffer)) return false;
+	  auto normalized = std::string_view(output).substr(pos);
+	  addOffset(&offsets, pos, original + start, normalized.size() == piece.size() && isCodepoint(piece) && isCodepoint(normalized));
+	  start = i;
+	}
+	i += n;
+      }
+      return true;
+    }
+
+    // Adds a segment that starts at a position of the normalized text. An exact
+    // segment that continues the previous one with the same shift is not added.
+    static void addOffset(std::vector<Offset> * offsets, size_t normalized, size_t original, bool is_exact) {
+      if (!offsets) return;
+      if (is_exact && !offsets->empty()) {
+	auto & last = offsets->back();
+	if (last.is_exact && static_cast<size_t>(last.original - last.normalized) == original - normalized) return;
+      }
+      offsets->push_back(Offset{ static_cast<int>(normalized), static_cast<int>(original), is_exact });
+    }
+
+    // maps the matches from positions in the normalized text to byte offsets in the input
+    static void mapOffsets(std::vector<match_data> & matches, const std::vector<Offset> & offsets) {
+      // returns the last segment that starts at or before pos
+      auto find = [&](int pos) {
+	return std::upper_bound(offsets.begin(), offsets.end(), pos, [](int pos, const Offset & offset) { return pos < offset.normalized; }) - 1;
+      };
+      for (auto & match : matches) {
+	auto first = find(match.pos_);
+	auto begin = first->is_exact ? first->original + match.pos_ - first->normalized : first->original;
+	auto end = begin;
+	if (match.size_ > 0) {
+	  auto last = find(match.pos_ + match.size_ - 1);
+	  end = last->is_exact ? last->original + match.pos_ + match.size_ - last->normalized : (last + 1)->original;
+	}
+	match.pos_ = begin;
+	match.size_ = end - begin;
+      }
+    }
+
+    // normalizes a span with utf8proc and appends it to output
+    static bool normalizeSpan(std::string_view input, std::string & output, std::vector<utf8proc_int32_t> & buffer) noexcept {
+      auto options = utf8proc_option_t(UTF8PROC_IGNORE | UTF8PROC_STRIPCC | UTF8PROC_CASEFOLD | UTF8PROC_COMPOSE);
+      auto s = reinterpret_cast<const utf8proc_uint8_t *>(input.data());
+      auto len = static_cast<utf8proc_ssize_t>(input.size());
+      auto n = utf8proc_decompose(s, len, buffer.data(), static_cast<utf8proc_ssize_t>(buffer.size()), options);
+      if (n < 0) return false;
+      // the encoded result and its terminator are written into the same buffer
+      if (static_cast<size_t>(n) >= buffer.size()) {
+	buffer.resize(static_cast<size_t>(n) + 1);
+	n = utf8proc_decompose(s, len, buffer.data(), n, options);
+	if (n < 0) return false;
+      }
+      n = utf8proc_reencode(buffer.data(), n, options);
+      if (n < 0) return false;
+      output.append(reinterpret_cast<const char *>(buffer.data()), static_cast<size_t>(n));
+      return true;
+    }
+
+    // Parses a metadata predicate such as .timestamp > "2024-10-01" at position pos
+    // of a string. Returns nullptr and leaves pos unchanged if there is none.
+    static std::unique_ptr<Node> parsePredicate(std::string_view s, size_t pos0, size_t & pos) {
+      auto i = pos0;
+      if (i >= s.size() || s[i] != '.') return nullptr;
+      auto key_end = s.find_first_not_of("0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz", ++i);
+      if (key_end == std::string_view::npos || key_end == i) return nullptr;
+      auto key = s.substr(i, key_end - i);
+      i = key_end;
+      while (i < s.size() && s[i] == ' ') i++;
+
+      static constexpr std::pair<const char *, Comparison> OPERATORS[] = {
+	{ "!=", Comparison::NOT_EQUAL }, { "<=", Comparison::LESS_EQUAL }, { ">=", Comparison::GREATER_EQUAL },
+	{ "=", Comparison::EQUAL }, { "<", Comparison::LESS }, { ">", Comparison::GREATER }
+      };
+      auto op = Comparison::EQUAL;
+      size_t op_size = 0;
+      for (auto & [ name, comparison ] : OPERATORS) {
+	if (s.compare(i, std::strlen(name), name) == 0) {
+	  op = comparison;
+	  op_size = std::strlen(name);
+	  break;
+	}
+      }
+      if (!op_size) return nullptr;
+      i += op_size;
+      while (i < s.size() && s[i] == ' ') i++;
+
+      std::string value;
+      bool is_number = false;
+      if (i < s.size() && s[i] == '"') {
+	auto value_end = s.find('"', i + 1);
+	if (value_end == std::string_view::npos) throw std::runtime_error("unterminated metadata value");
+	value = s.substr(i + 1, value_end - i - 1);
+	i = value_end + 1;
+      } else {
+	auto value_end = std::min(s.find_first_of(" ()", i), s.size());
+	if (value_end == i) throw std::runtime_error("missing metadata value");
+	value = s.substr(i, value_end - i);
+	i = value_end;
+	char * number_end;
+	std::strtod(value.c_str(), &number_end);
+	is_number = value.find_first_not_of("0123456789+-.eE") == std::string::npos && *number_end == '\0';
+      }
+      pos = i;
+      return std::make_unique<Predicate>(std::string(key), op, std::move(value), is_number);
+    }
+
+    // tokenizes a string to words. Metadata predicates are returned as single
+    // tokens that start with PREDICATE.
+    static std::deque<std::string> tokenize(std::string_view line) {
+      std::deque<std::string> r;
+      
+      size_t pos0 = 0, pos1;
+      while (pos0 < line.size()) {
+	if (line[pos0] == ' ' || line[pos0] == '\t') {
+	  pos0++;
+	} else if (parsePredicate(line, pos0, pos1)) {
+	  r.emplace_back(1, PREDICATE);
+	  r.back() += line.substr(pos0, pos1 - pos0);
+	  pos0 = pos1;
+	} else if (line[pos0] == '"') {
+	  pos0++;
+	  auto pos1 = line.find_first_of('"', pos0);
+	  if (pos1 == std::string_view::npos) pos1 = line.size();
+	  
+	  r.emplace_back(line.substr(pos0, pos1 - pos0));
+	  
+	  pos0 = pos1 + 1;
+	} else {
+	  auto pos1 = line.find_first_of(" \t", pos0);
+	  if (pos1 == std::string_view::npos) pos1 = line.size();
+	  
+	  if (pos0 < pos1) r.emplace_back(line.substr(pos0, pos1 - pos0));
+	  
+	  pos0 = pos1 + 1;
+	}
+      }
+      
+      return r;
+    }
+
+    // returns true if the token is an operator
+    static bool isOperator(const std::string & t) {
+      return t == "AND" || t == "OR" || t == "NEAR" || t == "ONEAR" || t == "NOT" || t.compare(0, 5, "NEAR/") == 0 || t.compare(0, 6, "ONEAR/") == 0;
+    }
+
+    // parses the maximum distance of NEAR/k and ONEAR/k
+    static int parseDistance(const std::string & t) {
+      if (t.empty() || t.size() > 6 || t.find_first_not_of("0123456789") != std::string::npos) {
+	throw std::runtime_error("invalid distance");
+      }
+      return std::stoi(t);
+    }
+
+    static std::unique_ptr<Node> createNode(const std::string & t, std::vector<std::unique_ptr<Node>> & node_stack) {
+      if (t == "AND") return std::make_unique<And>(node_stack);
+      if (t == "OR") return std::make_unique<Or>(node_stack);
+      if (t == "NEAR") return std::make_unique<Near>(node_stack);
+      if (t == "ONEAR") return std::make_unique<Near>(node_stack, 0);
+      if (t.compare(0, 5, "NEAR/") == 0) {
+	auto distance = parseDistance(t.substr(5));
+	return std::make_unique<Near>(node_stack, distance, distance);
+      }
+      if (t.compare(0, 6, "ONEAR/") == 0) return std::make_unique<Near>(node_stack, 0, parseDistance(t.substr(6)));
+      if (t == "NOT") return std::make_unique<AndNot>(node_stack);
+      if (!t.empty() && t.front() == PREDICATE) {
+	size_t pos;
+	return parsePredicate(t, 1, pos);
+      }
+      return std::make_unique<Term>(normalize(t));
+    }
+
+    // creates a binary expression tree from a expression string
+    static std::unique_ptr<Node> parse(std::string_view expression) {
+      // add spaces before and after brackets to ease tokenization
+      std::string e;
+      for (size_t i = 0; i < expression.size(); i++) {
+	auto c = expression[i];
+	if (c == '(' || c == ')') {
+	  if (!e.empty() && e.back() != ' ') e += ' ';
+	  e += c;
+	} else if (isspace(c)) {
+	  if (!e.empty() && e.back() != ' ') e += ' ';
+	} else {
+	  if (!e.empty() && (e.back() == '(' || e.back() == ')')) e += ' ';
+	  e += c;
+	}
+      }
+
+      auto tokens = tokenize(e);
+
+      std::vector<std::string> stack, rpn;
+      while (!tokens.empty()) {
+	auto t = std::move(tokens.front());
+	tokens.pop_front();
+
+	bool op1 = isOperator(t);
+	
+	if (!tokens.empty()) {
+	  auto & t2 = tokens.front();
+	  bool op2 = isOperator(t2);
+	  if (op1 && op2) throw std::runtime_error("missing term");
+	  if (!op1 && t != "(" && !op2 && t2 != ")") {
+	    tokens.push_front("OR");
+	  }
+	}
+	
+	if (op1 || t == "(") {
+	  stack.push_back(t);
+	} else if (t == ")") {
+	  while (!stack.empty() && stack.back() != "(") {
+	    rpn.push_back(stack.back());
+	    stack.pop_back();
+	  }
+	  if (stack.empty()) throw std::runtime_error("mismatched parentheses");
+	  stack.pop_back();
+	} else {
+	  rpn.push_back(t);
+	}
+      }
+
+      while (!stack.empty()) {
+	rpn.push_back(stack.back());
+	stack.pop_back();
+      }
+  
+      std::vector<std::unique_ptr<Node> > node_stack;
+      
+      for (auto & t : rpn) {
+	node_stack.push_back(createNode(t, node_stack));
+      }
+      
+      if (node_stack.empty()) {
+	throw std::runtime_error("no tokens");
+      } else if (node_stack.size() > 1) {
+	throw std::runtime_error("multiple node roots");
+      } else {
+	return optimize(std::move(node_stack.back()));
+      }
+    }
+
+    // Simplifies an expression tree: chains of ANDs and ORs are flattened into
+    // single nodes, duplicate operands are removed and constants are folded
+    static std::unique_ptr<Node> optimize(std::unique_ptr<Node> root) {
+      auto node = root->simplify(false);
+      return node ? std::move(node) : std::move(root);
+    }
+
+    std::vector<std::unique_ptr<Node>> expressions_;
+    std::vector<int> term_sizes_;
+    // the fragment of each term id, or NO_FRAGMENT for whole terms
+    std::vector<uint32_t> fragment_ids_;
+    std::vector<Fragment> fragments_;
+    std::vector<Program> programs_;
+    Automaton automaton_;
+    bool is_positional_ = false;
+    // the expressions that have metadata predicates or constants
+    std::vector<bool> has_fixed_operands_;
+    std::vector<uint32_t> fixed_queries_;
+    // the saved query that the automaton is mapped from
+    std::shared_ptr<const MappedFile> file_;
+    // identifies the results of the query in a result_cache
+    uint64_t id_ = result_cache::getQueryId();
+  };
+
+  using compiled_query = basic_compiled_query<>;
+
+  // the main class
+  template<typename Tokenizer = word_tokenizer>
+  class basic_matcher {
+  public:
+    using compiled_query = basic_compiled_query<Tokenizer>;
+    using result = typename compiled_query::result;
+
+    explicit basic_matcher(std::string_view expression)
+      : query_(std::make_shared<const compiled_query>(expression)) { }
+
+    // creates a matcher for a compiled query, e.g. one loaded from a file
+    explicit basic_matcher(std::shared_ptr<const compiled_query> query)
+      : query_(std::move(query)) { }
+
+    // returns true if the matcher matches text
+    bool match(std::string_view text) {
+      return query_->match(text, context_);
+    }
+
+    // returns true if the matcher matches a text with a metadata record
+    bool match(std::string_view text, const metadata & record) {
+      return query_->match(text, record, context_);
+    }
+
+    // returns true if the matcher matches text, using the results of duplicate texts in a cache
+    bool match(std::string_view text, result_cache & cache) {
+      return query_->match(text, context_, cache);
+    }
+
+    // returns extended search results for a text, using the results of duplicate texts in a cache
+    result search(std::string_view text, result_cache & cache) {
+      return query_->search(text, context_, cache);
+    }
+
+    // returns true if the matcher matches a UTF-16 or UTF-32 text
+    bool match(std::u16string_view text) {
+      return query_->match(text, context_);
+    }
+
+    bool match(std::u32string_view text) {
+      return query_->match(text, context_);
+    }
+
+    bool match(std::wstring_view text) {
+      return query_->match(text, context_);
+    }
+
+    // returns true if the matcher matches a text that is already normalized
+    bool match_normalized(std::string_view text) {
+      return query_->match_normalized(text, context_);
+    }
+
+    bool match_normalized(std::u16string_view text) {
+      return query_->match_normalized(text, context_);
+    }
+
+    bool match_normalized(std::u32string_view text) {
+      return query_->match_normalized(text, context_);
+    }
+
+    bool match_normalized(std::wstring_view text) {
+      return query_->match_normalized(text, context_);
+    }
+
+    // returns extended search results for a text
+    result search(std::string_view text) {
+      return query_->search(text, context_);
+    }
+
+    // returns extended search results for a text that is already normalized
+    result search_normalized(std::string_view text) {
+      return query_->search_normalized(text, context_);
+    }
+
+    // returns extended search results for a text with a metadata record
+    result search(std::string_view text, const metadata & record) {
+      return query_->search(text, record, context_);
+    }
+
+    // matches a batch of texts in parallel
+    template<typename Texts>
+    std::vector<bool> match_batch(const Texts & texts, thread_pool & pool) const {
+      return query_->match_batch(texts, pool);
+    }
+
+    // matches a batch of texts with their metadata records in parallel
+    template<typename Texts, typename Records>
+    std::vector<bool> match_batch(const Texts & texts, const Records & records, thread_pool & pool) const {
+      return query_->match_batch(texts, records, pool);
+    }
+
+    // searches a batch of texts in parallel
+    template<typename Texts>
+    std::vector<result> search_batch(const Texts & texts, thread_pool & pool) const {
+      return query_->search_batch(texts, pool);
+    }
+
+    // matches a batch of texts in parallel, using the results of duplicate texts in a cache
+    template<typename Texts>
+    std::vector<bool> match_batch(const Texts & texts, thread_pool & pool, result_cache & cache) const {
+      return query_->match_batch(texts, pool, cache);
+    }
+
+    // returns true if the matcher matches a large text, which is scanned in parallel chunks
+    bool match(std::string_view text, thread_pool & pool) {
+      return query_->match(text, context_, pool);
+    }
+
+    // returns extended search results for a large text, which is scanned in parallel chunks
+    result search(std::string_view text, thread_pool & pool) {
+      return query_->search(text, context_, pool);
+    }
+
+    // starts matching a text that is passed in chunks to feed()
+    void begin() {
+      query_->begin(context_);
+    }
+
+    // starts matching a text with a metadata record, which must be kept alive until finish()
+    void begin(const metadata & record) {
+      query_->begin(record, context_);
+    }
+
+    // processes the next chunk of the text
+    void feed(std::string_view chunk) {
+      query_->feed(chunk, context_);
+    }
+
+    // processes the rest of the text and returns true if the matcher matches it
+    bool finish() {
+      return query_->finish(context_);
+    }
+
+    // returns the compiled query, which can be shared with other threads
+    const std::shared_ptr<const compiled_query> & get_query() const noexcept { return query_; }
+
+    // returns the counters of the texts matched with the matcher
+    const scan_statistics & get_statistics() const noexcept { return context_.get_statistics(); }
+
+    // returns the profile of the nodes of the expression over a corpus
+    template<typename Texts>
+    std::vector<node_profile> profile(const Texts & texts) const {
+      return query_->profile(texts);
+    }
+
+  private:
+    std::shared_ptr<const compiled_query> query_;
+    scan_context context_;
+  };
+
+  // A set of expressions that share a single automaton, so that the cost of
+  // matching depends on the size of the text rather than on the number of expressions
+  template<typename Tokenizer = word_tokenizer>
+  class basic_matcher_set {
+  public:
+    using compiled_query = basic_compiled_query<Tokenizer>;
+
+    basic_matcher_set() { }
+
+    // adds an expression to the set and returns its id
+    size_t add(std::string_view expression) {
+      // parse the expression to report errors immediately
+      compiled_query::parse(expression);
+      expressions_.emplace_back(expression);
+      // the automaton must be rebuilt
+      query_.reset();
+      return expressions_.size() - 1;
+    }
+
+    // returns the number of expressions in the set
+    size_t size() const noexcept { return expressions_.size(); }
+
+    // returns the ids of the expressions that match text in ascending order
+    std::vector<size_t> match(std::string_view text) {
+      return get_query()->match_all(text, context_);
+    }
+
+    // returns the ids of the expressions that match a text with a metadata record
+    std::vector<size_t> match(std::string_view text, const metadata & record) {
+      return get_query()->match_all(text, record, context_);
+    }
+
+    // returns the counters of the texts matched with the set
+    const scan_statistics & get_statistics() const noexcept { return context_.get_statistics(); }
+
+    // returns the compiled expressions, which can be shared with other threads
+    const std::shared_ptr<const compiled_query> & get_query() {
+      if (!query_) query_ = std::make_shared<const compiled_query>(expressions_);
+      return query_;
+    }
+
+  private:
+    std::vector<std::string> expressions_;
+    std::shared_ptr<const compiled_query> query_;
+    scan_context context_;
+  };
+
+  // An inverted index of a stored corpus for running many queries over the same
+  // documents. The documents are normalized and split at the word boundaries of
+  // the automaton into segments. A segment is a run of word or non-word
+  // characters. Each distinct segment has a posting list of its positions, and
+  // the lists are stored as varint deltas. A term is found by joining the postings
+  // of the segments that match its pieces at consecutive positions. An expression
+  // is evaluated over sorted document lists, and the operands of an AND are decoded
+  // rarest first, each only in the documents that the previous ones left. This gives the same
+  // results as match() on each document. Metadata predicates, and a bare wildcard
+  // inside a proximity operator, are not supported.
+  template<typename Tokenizer = word_tokenizer>
+  class basic_document_index {
+  public:
+    using compiled_query = basic_compiled_query<Tokenizer>;
+
+    basic_document_index() { }
+
+    // adds a document to the index and returns its id
+    size_t add(std::string_view text) {
+      auto document = static_cast<uint32_t>(segment_counts_.size());
+      compiled_query::normalize(text, text_, buffer_);
+      std::string_view s = text_;
+      uint32_t position = 0, word = 0;
+      auto prev_class = word_class::NON_WORD;
+      size_t start = 0;
+      for (size_t i = 0; i < s.size(); ) {
+	char32_t codepoint;
+	auto n = compiled_query::decodeCodepoint(s, i, codepoint);
+	auto cls = compiled_query::getWordClass(codepoint);
+	if (compiled_query::isBoundary(prev_class, cls)) {
+	  if (i > start) {
+	    addSegment(s.substr(start, i - start), document, position++, word);
+	    start = i;
+	  }
+	  // the words are counted as in the scan
+	  if (cls != word_class::NON_WORD) word++;
+	}
+	prev_class = cls;
+	i += n;
+      }
+      if (start < s.size()) addSegment(s.substr(start), document, position++, word);
+      segment_counts_.push_back(position);
+      return document;
+    }
+
+    // returns the number of documents in the index
+    size_t size() const noexcept { return segment_counts_.size(); }
+
+    // returns the number of distinct segments in the index
+    size_t get_segment_count() const noexcept { return segments_.size(); }
+
+    // returns the ids of the documents that match an expression in ascending order
+    std::vector<size_t> search(std::string_view expression) const {
+      return search(compiled_query(expression));
+    }
+
+    // returns the ids of the documents that match a compiled expression in ascending order
+    std::vector<size_t> search(const compiled_query & query) const {
+      if (query.expressions_.size() != 1) throw std::runtime_error("the query must have a single expression");
+      Evaluation evaluation;
+      auto documents = getDocuments(*query.expressions_.front(), nullptr, evaluation, false);
+      return std::vector<size_t>(documents.begin(), documents.end());
+    }
+
+  private:
+    using Node = typename compiled_query::Node;
+    using Term = typename compiled_query::Term;
+
+    // the position of a segment and the index of the last word that starts at or before it
+    struct Occurrence {
+      uint32_t document, position, word;
+    };
+
+    // The positions of a segment. Each position is stored as the difference of the
+    // document id plus one, and the position and word index relative to the previous
+    // position in the same document, so that a new document has a nonzero first value.
+    // Every SKIP_INTERVAL documents the offset of the document is kept for skipping.
+    struct Posting {
+      struct Skip {
+	uint32_t document, end_document, offset;
+      };
+      static constexpr uint32_t SKIP_INTERVAL = 64;
+
+      std::vector<uint8_t> data;
+      std::vector<Skip> skips;
+      uint32_t end_document = 0, last_position = 0, last_word = 0, document_count = 0;
+
+      void add(uint32_t document, uint32_t position, uint32_t word) {
+	if (document + 1 != end_document) {
+	  if (document_count++ % SKIP_INTERVAL == 0) skips.push_back(Skip{ document, end_document, static_cast<uint32_t>(data.size()) });
+	  last_position = last_word = 0;
+	}
+	appendVarint(data, document + 1 - end_document);
+	appendVarint(data, position - last_position);
+	appendVarint(data, word - last_word);
+	end_document = document + 1;
+	last_position = position;
+	last_word = word;
+      }
+
+      // Decodes the positions in a sorted list of documents, or all positions if
+      // documents is nullptr. The skips before each document are found by galloping.
+      template<typename F>
+      void decode(const std::vector<uint32_t> * documents, F && callback) const {
+	if (documents && documents->empty()) return;
+	uint32_t end_document = 0, position = 0, word = 0;
+	size_t next = 0, skip = 0;
+	for (auto p = data.data(), end = p + data.size(); p < end; ) {
+	  if (documents && skip < skips.size() && skips[skip].document <= (*documents)[next]) {
+	    auto target = (*documents)[next];
+	    size_t step = 1, hi = skip;
+	    while (hi < skips.size() && skips[hi].document <= target) {
+	      skip = hi;
+	      hi += step;
+	      step *= 2;
+	    }
+	    skip = static_cast<size_t>(std::upper_bound(skips.begin() + static_cast<std::ptrdiff_t>(skip), skips.begin() + static_cast<std::ptrdiff_t>(std::min(hi, skips.size())), target, [](uint32_t document, const Skip & s) { return document < s.document; }) - skips.begin());
+	    auto & s = skips[skip - 1];
+	    if (data.data() + s.offset > p) {
+	      p = data.data() + s.offset;
+	      end_document = s.end_document;
+	    }
+	  }
+	  auto delta = readVarint(p);
+	  if (delta) {
+	    end_document += delta;
+	    position = word = 0;
+	  }
+	  position += readVarint(p);
+	  word += readVarint(p);
+	  auto document = end_document - 1;
+	  if (documents) {
+	    while ((*documents)[next] < document) {
+	      if (++next == documents->size()) return;
+	    }
+	    if ((*documents)[next] != document) continue;
+	  }
+	  callback(Occurrence{ document, position, word });
+	}
+      }
+    };
+
+    // A piece of a term that matches a single segment. The parts are separated by
+    // interior wildcards, and an anchored end must be at a word boundary.
+    struct Piece {
+      std::vector<std::string> parts;
+      bool is_start_anchored, is_end_anchored;
+    };
+
+    static void appendVarint(std::vector<uint8_t> & data, uint32_t value) {
+      for (; value >= 0x80; value >>= 7) data.push_back(static_cast<uint8_t>(value | 0x80));
+      data.push_back(static_cast<uint8_t>(value));
+    }
+
+    static uint32_t readVarint(const uint8_t *& p) noexcept {
+      uint32_t value = 0;
+      for (int shift = 0; ; shift += 7) {
+	auto byte = *p++;
+	value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+	if (!(byte & 0x80)) return value;
+      }
+    }
+
+    void addSegment(std::string_view segment, uint32_t document, uint32_t position, uint32_t word) {
+      auto it = dictionary_.find(segment);
+      if (it == dictionary_.end()) {
+	char32_t codepoint;
+	compiled_query::decodeCodepoint(segment, 0, codepoint);
+	segments_.emplace_back(segment);
+	is_word_.push_back(compiled_query::getWordClass(codepoint) != word_class::NON_WORD);
+	postings_.emplace_back();
+	it = dictionary_.emplace(segments_.back(), static_cast<uint32_t>(postings_.size() - 1)).first;
+      }
+      postings_[it->second].add(document, position, word);
+    }
+
+    // Splits the patterns of a term at the boundaries into pieces. The fragments of
+    // an interior wildcard are joined within a word, so the last piece of a fragment
+    // and the first piece of the next one match the same segment.
+    static std::vector<Piece> getPieces(const Term & term) {
+      std::vector<Piece> r;
+      auto & patterns = term.getPatterns();
+      for (size_t i = 0; i < patterns.size(); i++) {
+	std::string_view text = patterns[i].text;
+	bool is_start_anchored = !text.empty() && text.front() == BOUNDARY;
+	if (is_start_anchored) text.remove_prefix(1);
+	bool is_end_anchored = !text.empty() && text.back() == BOUNDARY;
+	if (is_end_anchored) text.remove_suffix(1);
+	if (text.empty()) {
+	  // a bare wildcard in a proximity operator matches the boundaries
+	  if (is_start_anchored || is_end_anchored) throw std::runtime_error("bare wildcard in a proximity operator");
+	  continue;
+	}
+	for (size_t start = 0; start <= text.size(); ) {
+	  auto end = std::min(text.find(BOUNDARY, start), text.size());
+	  std::string part(text.substr(start, end - start));
+	  bool is_end = end < text.size() || is_end_anchored;
+	  if (start == 0 && i > 0) {
+	    r.back().parts.push_back(std::move(part));
+	    r.back().is_end_anchored = is_end;
+	  } else {
+	    r.push_back(Piece{ { std::move(part) }, start > 0 || is_start_anchored, is_end });
+	  }
+	  start = end + 1;
+	}
+      }
+      return r;
+    }
+
+    // returns true if a segment matches a piece. The parts are found from left to
+    // right, which is how the fragments of a wildcard term are joined in the scan.
+    static bool matchPiece(std::string_view s, const Piece & piece) noexcept {
+      size_t pos = 0;
+      for (size_t i = 0; i < piece.parts.size(); i++) {
+	auto & part = piece.parts[i];
+	auto found = i == 0 && piece.is_start_anchored ? (s.compare(0, part.size(), part) == 0 ? 0 : std::string_view::npos) : s.find(part, pos);
+	if (found == std::string_view::npos) return false;
+	if (i + 1 == piece.parts.size() && piece.is_end_anchored) {
+	  if (s.size() < found + part.size() || s.compare(s.size() - part.size(), part.size(), part) != 0) return false;
+	  if (i == 0 && piece.is_start_anchored && s.size() != part.size()) return false;
+	}
+	pos = found + part.size();
+      }
+      return true;
+    }
+
+    // returns the ids of the segments that match a piece
+    std::vector<uint32_t> findSegments(const Piece & piece) const {
+      std::vector<uint32_t> r;
+      if (piece.parts.size() == 1 && piece.is_start_anchored && piece.is_end_anchored) {
+	auto it = dictionary_.find(piece.parts.front());
+	if (it != dictionary_.end()) r.push_back(it->second);
+      } else {
+	for (size_t segment = 0; segment < segments_.size(); segment++) {
+	  if (matchPiece(segments_[segment], piece)) r.push_back(static_cast<uint32_t>(segment));
+	}
+      }
+      return r;
+    }
+
+    // Returns the positions of a piece in a list of documents, sorted by document
+    // and position. The text has a boundary before its first segment and after its
+    // last segment only if they are words.
+    std::vector<Occurrence> findPiece(const Piece & piece, const std::vector<uint32_t> & segments, const std::vector<uint32_t> * documents) const {
+      std::vector<Occurrence> r;
+      for (auto segment : segments) {
+	bool is_word = is_word_[segment];
+	postings_[segment].decode(documents, [&](const Occurrence & occurrence) {
+	  if (!is_word && piece.is_start_anchored && occurrence.position == 0) return;
+	  if (!is_word && piece.is_end_anchored && occurrence.position + 1 == segment_counts_[occurrence.document]) return;
+	  r.push_back(occurrence);
+	});
+      }
+      if (segments.size() > 1) sortOccurrences(r);
+      return r;
+    }
+
+    // sorts the concatenated lists of several segments by a counting sort on the
+    // documents, after which the runs of each document are short
+    void sortOccurrences(std::vector<Occurrence> & occurrences) const {
+      auto byPosition = [](const Occurrence & a, const Occurrence & b) {
+	return a.document < b.document || (a.document == b.document && a.position < b.position);
+      };
+      if (occurrences.size() * 8 < segment_counts_.size()) {
+	std::sort(occurrences.begin(), occurrences.end(), byPosition);
+	return;
+      }
+      std::vector<uint32_t> starts(segment_counts_.size() + 1);
+      for (auto & occurrence : occurrences) starts[occurrence.document + 1]++;
+      std::partial_sum(starts.begin(), starts.end(), starts.begin());
+      std::vector<Occurrence> r(occurrences.size());
+      for (auto & occurrence : occurrences) r[starts[occurrence.document]++] = occurrence;
+      for (size_t i = 0, j; i < r.size(); i = j) {
+	for (j = i + 1; j < r.size() && r[j].document == r[i].document; j++) { }
+	if (j - i > 1) std::sort(r.begin() + static_cast<std::ptrdiff_t>(i), r.begin() + static_cast<std::ptrdiff_t>(j), byPosition);
+      }
+      occurrences = std::move(r);
+    }
+
+    static std::vector<uint32_t> getDocuments(const std::vector<Occurrence> & occurrences) {
+      std::vector<uint32_t> r;
+      for (auto & occurrence : occurrences) {
+	if (r.empty() || r.back() != occurrence.document) r.push_back(occurrence.document);
+      }
+      return r;
+    }
+
+    // Returns the occurrences of a term in a list of documents at the position of its
+    // last piece. The rarest piece is decoded first, and the other pieces only in
+    // the documents where it was found.
+    std::vector<Occurrence> findTerm(const Term & term, const std::vector<uint32_t> * documents) const {
+      auto pieces = getPieces(term);
+      if (pieces.empty()) return std::vector<Occurrence>();
+      std::vector<std::vector<uint32_t>> segments;
+      size_t rarest = 0, rarest_size = std::numeric_limits<size_t>::max();
+      for (size_t i = 0; i < pieces.size(); i++) {
+	segments.push_back(findSegments(pieces[i]));
+	size_t size = 0;
+	for (auto segment : segments.back()) size += postings_[segment].data.size();
+	if (size < rarest_size) {
+	  rarest = i;
+	  rarest_size = size;
+	}
+      }
+      std::vector<std::vector<Occurrence>> lists(pieces.size());
+      lists[rarest] = findPiece(pieces[rarest], segments[rarest], documents);
+      auto candidates = getDocuments(lists[rarest]);
+      for (size_t i = 0; i < pieces.size(); i++) {
+	if (i != rarest && !candidates.empty()) lists[i] = findPiece(pieces[i], segments[i], &candidates);
+      }
+
+      // the occurrences that are followed by the next piece
+      auto r = std::move(lists.front());
+      for (size_t i = 1; i < pieces.size() && !r.empty(); i++) {
+	auto & next = lists[i];
+	size_t n = 0, j = 0;
+	for (auto & occurrence : r) {
+	  while (j < next.size() && (next[j].document < occurrence.document || (next[j].document == occurrence.document && next[j].position <= occurrence.position))) j++;
+	  if (j < next.size() && next[j].document == occurrence.document && next[j].position == occurrence.position + 1) r[n++] = next[j];
+	}
+	r.resize(n);
+      }
+      return r;
+    }
+
+    // the occurrences of the terms in proximity operators, which are kept for the
+    // operators after their operands are evaluated
+    using Evaluation = std::unordered_map<const Term *, std::vector<Occurrence>>;
+
+    // returns an upper bound of the number of documents where a node is true
+    size_t estimate(const Node & node) const {
+      if (auto term = dynamic_cast<const Term *>(&node)) {
+	auto r = size();
+	for (auto & piece : getPieces(*term)) {
+	  size_t count = 0;
+	  for (auto segment : findSegments(piece)) count += postings_[segment].document_count;
+	  r = std::min(r, count);
+	}
+	return r;
+      }
+      auto constant = node.getConstant();
+      if (constant != compiled_query::Outcome::UNDECIDED) return constant == compiled_query::Outcome::MATCH ? size() : 0;
+      auto & children = node.getChildren();
+      if (children.empty()) return size();
+      if (dynamic_cast<const typename compiled_query::Or *>(&node)) {
+	size_t r = 0;
+	for (auto & child : children) r += estimate(*child);
+	return std::min(r, size());
+      }
+      if (dynamic_cast<const typename compiled_query::AndNot *>(&node)) return estimate(*children[0]);
+      size_t r = size();
+      for (auto & child : children) r = std::min(r, estimate(*child));
+      return r;
+    }
+
+    // Returns the sorted ids of the documents where a node is true, out of a list of
+    // documents or all documents if documents is nullptr. Each node is evaluated in
+    // a superset of the documents where its parent is true.
+    std::vector<uint32_t> getDocuments(const Node & node, const std::vector<uint32_t> * documents, Evaluation & evaluation, bool is_positional) const {
+      if (auto term = dynamic_cast<const Term *>(&node)) {
+	auto occurrences = findTerm(*term, documents);
+	auto r = getDocuments(occurrences);
+	if (is_positional) evaluation[term] = std::move(occurrences);
+	return r;
+      }
+      if (dynamic_cast<const typename compiled_query::Predicate *>(&node)) {
+	throw std::runtime_error("metadata predicates are not supported by the index");
+      }
+      if (auto constant = node.getConstant(); constant != compiled_query::Outcome::UNDECIDED) {
+	std::vector<uint32_t> r;
+	if (constant == compiled_query::Outcome::MATCH) {
+	  if (documents) return *documents;
+	  for (uint32_t document = 0; document < segment_counts_.size(); document++) r.push_back(document);
+	}
+	return r;
+      }
+      auto & children = node.getChildren();
+      std::vector<uint32_t> r;
+      if (dynamic_cast<const typename compiled_query::Or *>(&node)) {
+	for (auto & child : children) {
+	  auto list = getDocuments(*child, documents, evaluation, is_positional);
+	  std::vector<uint32_t> merged;
+	  std::set_union(r.begin(), r.end(), list.begin(), list.end(), std::back_inserter(merged));
+	  r = std::move(merged);
+	}
+      } else if (dynamic_cast<const typename compiled_query::AndNot *>(&node)) {
+	auto left = getDocuments(*children[0], documents, evaluation, is_positional);
+	auto right = getDocuments(*children[1], &left, evaluation, is_positional);
+	std::set_difference(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(r));
+      } else {
+	// each operand is evaluated in the documents where the previous operands are
+	// true, starting from the operand with the fewest documents
+	bool is_near = dynamic_cast<const typename compiled_query::Near *>(&node) != nullptr;
+	std::vector<std::pair<size_t, const Node *>> operands;
+	for (auto & child : children) operands.emplace_back(estimate(*child), child.get());
+	std::stable_sort(operands.begin(), operands.end(), [](auto & a, auto & b) { return a.first < b.first; });
+	r = getDocuments(*operands.front().second, documents, evaluation, is_positional || is_near);
+	for (size_t i = 1; i < operands.size() && !r.empty(); i++) r = getDocuments(*operands[i].second, &r, evaluation, is_positional || is_near);
+	// the proximity of the matches is checked in the documents that have both operands
+	if (is_near && !r.empty()) r = filterNear(node, r, evaluation);
+      }
+      return r;
+    }
+
+    static void getTerms(const Node & node, std::vector<const Term *> & terms) {
+      if (auto term = dynamic_cast<const Term *>(&node)) terms.push_back(term);
+      for (auto & child : node.getChildren()) getTerms(*child, terms);
+    }
+
+    // evaluates a proximity operator in each document with the match lists of its terms
+    std::vector<uint32_t> filterNear(const Node & node, const std::vector<uint32_t> & documents, Evaluation & evaluation) const {
+      std::vector<const Term *> terms;
+      getTerms(node, terms);
+      scan_context context;
+      for (auto term : terms) context.matches_.resize(std::max<size_t>(context.matches_.size(), term->getId() + 1));
+      std::vector<size_t> next(terms.size());
+      std::vector<uint32_t> r;
+      for (auto document : documents) {
+	for (auto term : terms) context.matches_[term->getId()].clear();
+	// Terms with the same id share a match list. A term that was not evaluated in
+	// the document is in an operand that is false there, so any non-empty list of
+	// the id is complete.
+	for (size_t i = 0; i < terms.size(); i++) {
+	  auto & matches = context.matches_[terms[i]->getId()];
+	  auto & list = evaluation[terms[i]];
+	  while (next[i] < list.size() && list[next[i]].document < document) next[i]++;
+	  bool is_filled = !matches.empty();
+	  for (; next[i] < list.size() && list[next[i]].document == document; next[i]++) {
+	    auto & occurrence = list[next[i]];
+	    if (!is_filled) matches.emplace_back(static_cast<int>(occurrence.position), 1, static_cast<int>(occurrence.word));
+	  }
+	}
+	if (node.eval(context)) r.push_back(document);
+      }
+      return r;
+    }
+
+    // the dictionary of the distinct segments refers to the strings in segments_
+    std::deque<std::string> segments_;
+    std::unordered_map<std::string_view, uint32_t> dictionary_;
+    std::vector<bool> is_word_;
+    std::vector<Posting> postings_;
+    // the number of segments in each document
+    std::vector<uint32_t> segment_counts_;
+    // normalized text and a buffer for utf8proc, reused between documents
+    std::string text_;
+    std::vector<utf8proc_int32_t> buffer_;
+  };
+
+  using document_index = basic_document_index<>;
+
+  // A matcher for an expression that is known at compile time. The expression is
+  // parsed and the automaton is built during compilation into static tables, and
+  // the expression is evaluated by a truth table or by an unrolled program, so the
+  // matcher has no startup cost and printable ASCII is matched without allocation.
+  // Other texts are normalized into buffers of the matcher. Proximity operators,
+  // metadata predicates and wildcards inside words are not supported, at most 64
+  // distinct terms are allowed, and the terms must be in normalized form except
+  // for ASCII case. The expression is an array with static storage duration:
+  //
+  //   static constexpr char SPAM[] = "viagra OR (cheap AND pills)";
+  //   boolean_matcher::static_matcher<SPAM> m;
+  template<const char * Expression, typename Tokenizer = word_tokenizer>
+  class basic_static_matcher {
+  public:
+    basic_static_matcher() { }
+
+    // returns true if the matcher matches text
+    bool match(std::string_view text) {
+      uint64_t hits = 0;
+      if (isDecided(hits)) return evaluate(hits);
+      // printable ASCII is folded by the byte classes of the automaton
+      if (!isPrintableAscii(text)) {
+	compiled_query::normalize(text, text_, buffer_);
+	text = text_;
+      }
+      scan(text, hits);
+      return evaluate(hits);
+    }
+
+    // returns the number of distinct terms in the expression
+    static constexpr size_t get_term_count() noexcept { return QUERY.term_count; }
+
+    // returns the number of states in the automaton
+    static constexpr size_t get_state_count() noexcept { return STATE_COUNT; }
+
+  private:
+    using compiled_query = basic_compiled_query<Tokenizer>;
+
+    enum class Opcode : uint8_t { TERM, CONSTANT, AND, OR, AND_NOT };
+    struct Instruction {
+      Opcode op = Opcode::TERM;
+      uint8_t term = 0;
+    };
+
+    enum class TokenType : uint8_t { TERM, AND, OR, AND_NOT, OPEN, CLOSE };
+    struct Token {
+      size_t begin = 0, size = 0;
+      TokenType type = TokenType::TERM;
+    };
+
+    static constexpr size_t LENGTH = std::char_traits<char>::length(Expression);
+    // the size of the expression with spaces around the brackets, which bounds
+    // the number of tokens and the sizes of the terms
+    static constexpr size_t CAPACITY = 2 * LENGTH + 2;
+
+    // the program of the expression and the patterns of its distinct terms
+    struct Query {
+      std::array<Instruction, 2 * CAPACITY> code{};
+      std::array<char, CAPACITY> texts{};
+      std::array<size_t, CAPACITY> text_ends{};
+      std::array<char, 4 * CAPACITY> patterns{};
+      std::array<size_t, CAPACITY> pattern_ends{};
+      size_t code_size = 0, texts_size = 0, patterns_size = 0, term_count = 0;
+      bool is_monotone = true;
     };
 
-    class And : public Node {
-    public:
-      And(std::vector<std::unique_ptr<Node> > & node_stack) : Node(node_stack) { }
-          
-      bool eval() const override {
-	return left_->eval() && right_->eval();
+    // decodes a UTF-8 sequence at compile time as decodeCodepoint does
+    static constexpr size_t decode(std::string_view s, size_t i, char32_t & codepoint) noexcept {
+      auto c = static_cast<unsigned char>(s[i]);
+      size_t n = c < 0x80 ? 1 : (c >> 5) == 6 ? 2 : (c >> 4) == 14 ? 3 : (c >> 3) == 30 ? 4 : 0;
+      if (!n || i + n > s.size()) {
+	codepoint = 0xfffd;
+	return 1;
       }
-  
-      std::vector<match_data> getMatches() const override {
-	auto left_match = left_->getMatches();
-	if (!left_match.empty()) {
-	  auto right_match = right_->getMatches();
-	  if (!right_match.empty()) {
-	    std::copy(right_match.begin(), right_match.end(), std::back_inserter(left_match));
-	    return left_match;
-	  }
+      codepoint = n == 1 ? c : n == 2 ? (c & 0x1f) : n == 3 ? (c & 0x0f) : (c & 0x07);
+      for (size_t j = 1; j < n; j++) {
+	auto b = static_cast<unsigned char>(s[i + j]);
+	if ((b & 0xc0) != 0x80) {
+	  codepoint = 0xfffd;
+	  return 1;
 	}
-	return std::vector<match_data>();
+	codepoint = (codepoint << 6) | (b & 0x3f);
       }
+      return n;
+    }
 
-      void serialize(std::string & r) const override {
-	if (!r.empty()) r += " ";
-	r += "(";
-	left_->serialize(r);
-	r += " AND";
-	right_->serialize(r);
-	r += ")";
+    // throws if a metadata predicate starts at position i, as in parsePredicate()
+    static constexpr void checkPredicate(std::string_view s, size_t i) {
+      if (i >= s.size() || s[i] != '.') return;
+      auto key_end = s.find_first_not_of("0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz", ++i);
+      if (key_end == std::string_view::npos || key_end == i) return;
+      i = key_end;
+      while (i < s.size() && s[i] == ' ') i++;
+      if (i < s.size() && (s[i] == '=' || s[i] == '<' || s[i] == '>' || (s[i] == '!' && s.substr(i, 2) == "!="))) {
+	throw std::runtime_error("metadata predicates are not supported in static matchers");
       }
-    };
+    }
 
-    class Or : public Node {
-    public:
-      Or(std::vector<std::unique_ptr<Node> > & node_stack) : Node(node_stack) { }
-      
-      bool eval() const override {
-	return left_->eval() || right_->eval();
+    static constexpr TokenType getTokenType(std::string_view t) {
+      if (t == "AND") return TokenType::AND;
+      if (t == "OR") return TokenType::OR;
+      if (t == "NOT") return TokenType::AND_NOT;
+      if (t == "(") return TokenType::OPEN;
+      if (t == ")") return TokenType::CLOSE;
+      if (t == "NEAR" || t == "ONEAR" || t.substr(0, 5) == "NEAR/" || t.substr(0, 6) == "ONEAR/") {
+	throw std::runtime_error("proximity operators are not supported in static matchers");
       }
+      return TokenType::TERM;
+    }
 
-      std::vector<match_data> getMatches() const override {
-	auto left_match = left_->getMatches();
-	auto right_match = right_->getMatches();
+    static constexpr bool isOperator(TokenType type) noexcept {
+      return type == TokenType::AND || type == TokenType::OR || type == TokenType::AND_NOT;
+    }
 
-	std::copy(right_match.begin(), right_match.end(), std::back_inserter(left_match));
-    
-	return left_match;
-      }
-    
-      void serialize(std::string & r) const override {
-	if (!r.empty()) r += " ";
-	r += "(";
-	left_->serialize(r);
-	r += " OR";
-	right_->serialize(r);
-	r += ")";
+    // appends a term to the program, and its pattern to the query if the term is
+    // new. The text and the pattern are created as by normalize() and the Term
+    // constructor, except that only ASCII is case folded.
+    static constexpr void addTerm(Query & q, std::string_view t) {
+      auto text_start = q.texts_size;
+      bool is_constant = true;
+      for (auto c : t) {
+	if ((c >= 0 && c < 0x20) || c == 0x7f) continue;
+	if (c != '*') is_constant = false;
+	q.texts[q.texts_size++] = c >= 'A' && c <= 'Z' ? static_cast<char>(c + 0x20) : c;
       }
-    };
-
-    class AndNot : public Node {
-    public:
-      AndNot(std::vector<std::unique_ptr<Node> > & node_stack) : Node(node_stack) { }
-      
-      bool eval() const override {
-	if (right_->eval()) return false;
-	return left_->eval();
+      // a bare wildcard is true
+      if (is_constant) {
+	q.texts_size = text_start;
+	q.code[q.code_size++] = Instruction{ Opcode::CONSTANT, 0 };
+	return;
       }
-  
-      std::vector<match_data> getMatches() const override {
-	if (right_->eval()) {
-	  return std::vector<match_data>();
-	} else {
-	  return left_->getMatches();
+      std::string_view term(q.texts.data() + text_start, q.texts_size - text_start);
+      for (size_t i = 0, start = 0; i < q.term_count; start = q.text_ends[i++]) {
+	if (std::string_view(q.texts.data() + start, q.text_ends[i] - start) == term) {
+	  q.texts_size = text_start;
+	  q.code[q.code_size++] = Instruction{ Opcode::TERM, static_cast<uint8_t>(i) };
+	  return;
 	}
       }
-  
-      void serialize(std::string & r) const override {
-	if (!r.empty()) r += " ";
-	r += "(";
-	left_->serialize(r);
-	r += " NOT";
-	right_->serialize(r);
-	r += ")";
-      }
-    };
-
-    class Near : public Node {
-    public:
-      Near(std::vector<std::unique_ptr<Node> > & node_stack, int left_distance = 4, int right_distance = 4)
-	: Node(node_stack),
-	  left_distance_(left_distance),
-	  right_distance_(right_distance) { }
+      if (q.term_count == 64) throw std::runtime_error("too many terms for a static matcher");
 
-      bool eval() const override {
-	auto matches = getMatches();
-	return !matches.empty();
+      if (!term.empty() && term.front() == '*') term.remove_prefix(1);
+      else q.patterns[q.patterns_size++] = BOUNDARY;
+      bool has_suffix = true;
+      if (!term.empty() && term.back() == '*') {
+	term.remove_suffix(1);
+	has_suffix = false;
       }
-      
-      std::vector<match_data> getMatches() const override {
-	std::vector<match_data> result;
-	auto left_matches = left_->getMatches();
-	
-	if (!left_matches.empty()) {
-	  auto right_matches = right_->getMatches();
-	  
-	  for (auto & left_match : left_matches) {
-	    auto range_start = left_match.word_index_ - left_distance_;
-	    auto range_end = left_match.word_index_ + right_distance_;
-	    
-	    for (auto & right_match : right_matches) {
-	      if (right_match.word_index_ >= range_start && right_match.word_index_ <= range_end) {
-		result.push_back(left_match);
-		result.push_back(right_match);
-	      }
-	    }
+      auto prev_class = word_class::NON_WORD;
+      for (size_t i = 0; i < term.size(); ) {
+	char32_t codepoint = 0;
+	auto n = decode(term, i, codepoint);
+	auto cls = compiled_query::getWordClass(codepoint);
+	if (codepoint == '*' && prev_class != word_class::NON_WORD) {
+	  auto j = term.find_first_not_of('*', i);
+	  char32_t next = 0;
+	  if (j != std::string_view::npos && (decode(term, j, next), compiled_query::getWordClass(next) != word_class::NON_WORD)) {
+	    throw std::runtime_error("wildcards inside words are not supported in static matchers");
 	  }
 	}
-	
-	return result;
-      }
-      
-      void serialize(std::string & r) const override {
-	if (!r.empty()) r += " ";
-	r += "(";
-	left_->serialize(r);
-	if (left_distance_ == 0) r += " ONEAR";
-	else r += " NEAR";
-	right_->serialize(r);
-	r += ")";
+	if (i && compiled_query::isBoundary(prev_class, cls)) q.patterns[q.patterns_size++] = BOUNDARY;
+	prev_class = cls;
+	for (auto end = i + n; i < end; i++) q.patterns[q.patterns_size++] = term[i];
       }
+      if (has_suffix) q.patterns[q.patterns_size++] = BOUNDARY;
 
-    private:
-      int left_distance_, right_distance_;
-    };
+      q.text_ends[q.term_count] = q.texts_size;
+      q.pattern_ends[q.term_count] = q.patterns_size;
+      q.code[q.code_size++] = Instruction{ Opcode::TERM, static_cast<uint8_t>(q.term_count++) };
+    }
 
-    // A state for the Aho-Corasick String Search
-    class SearchState {
-    public:
-      SearchState(char32_t character = 0) : character_(character) { }
-      
-      SearchState * findTransition(char32_t character) {
-	auto it = transitions_.find(character);
-	if (it == transitions_.end()) return nullptr;
-	return it->second.get();
-      }
-      
-      void addOutput(Node * node) {
-	output_.insert(node);
-      }
-      
-      std::unordered_set<Node *> & getOutput() { return output_; }
-      
-      std::unordered_map< char32_t, std::unique_ptr<SearchState> > & getTransitions() {
-	return transitions_;
-      }
-      
-      SearchState * getFailureTransition() { return failure_transition_; }
-      void setFailureTransition(SearchState * state) { failure_transition_ = state; }
-      
-      char32_t getCharacter() const { return character_; }
-      
-      SearchState * getParent() { return parent_; }
-      
-      SearchState & addPattern(std::u32string_view pattern) {
-	if (pattern.empty()) {
-	  return *this;
+    // parses the expression into a postfix program as parse() does
+    static constexpr Query parse() {
+      // add spaces before and after brackets to ease tokenization
+      std::array<char, CAPACITY> e{};
+      size_t e_size = 0;
+      for (size_t i = 0; i < LENGTH; i++) {
+	auto c = Expression[i];
+	if (c == '(' || c == ')') {
+	  if (e_size && e[e_size - 1] != ' ') e[e_size++] = ' ';
+	  e[e_size++] = c;
+	} else if (c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r') {
+	  if (e_size && e[e_size - 1] != ' ') e[e_size++] = ' ';
 	} else {
-	  auto new_state = findTransition(pattern.front());
-	  if (new_state) {
-	    return new_state->addPattern(pattern.substr(1));
-	  } else {
-	    return createTransition(std::move(pattern));
-	  }
+	  if (e_size && (e[e_size - 1] == '(' || e[e_size - 1] == ')')) e[e_size++] = ' ';
+	  e[e_size++] = c;
 	}
       }
-      
-      void computeFailureTransitions() {
-	std::deque<SearchState *> q;
-	
-	for (auto & [ character, transition ] : transitions_) {
-	  q.push_back(transition.get());
-	  transition->setFailureTransition(this);
+      std::string_view line(e.data(), e_size);
+
+      std::array<Token, CAPACITY> tokens{};
+      size_t token_count = 0;
+      for (size_t pos0 = 0; pos0 < line.size(); ) {
+	if (line[pos0] == ' ' || line[pos0] == '\t') {
+	  pos0++;
+	  continue;
 	}
-	
-	while (!q.empty()) {
-	  auto state = q.front();
-	  q.pop_front();
-	  
-	  auto failure_state = state->getParent()->getFailureTransition();
-	  while (failure_state && failure_state->findTransition(state->getCharacter()) == nullptr) {
-	    failure_state = failure_state->getFailureTransition();
-	  }
-	  
-	  if (failure_state) {
-	    state->setFailureTransition(failure_state->findTransition(state->getCharacter()));
-	    for (auto & node : state->getFailureTransition()->getOutput()) {
-	      state->addOutput(node);
-	    }
-	  } else {
-	    state->setFailureTransition(this);
-	  }
-	  
-	  for (auto & [ character, transition ] : state->getTransitions()) {
-	    q.push_back(transition.get());
-	  }
+	checkPredicate(line, pos0);
+	size_t pos1 = 0;
+	if (line[pos0] == '"') {
+	  pos1 = line.find_first_of('"', ++pos0);
+	  if (pos1 == std::string_view::npos) pos1 = line.size();
+	} else {
+	  pos1 = line.find_first_of(" \t", pos0);
+	  if (pos1 == std::string_view::npos) pos1 = line.size();
 	}
-	
-	setFailureTransition(this);
-      }
-      
-    private:
-      SearchState * addTransition(std::unique_ptr<SearchState> to) {
-	auto tmp = to.get();
-	to->parent_ = this;
-	transitions_[ to->character_ ] = std::move(to);
-	return tmp;
+	auto type = getTokenType(line.substr(pos0, pos1 - pos0));
+	tokens[token_count++] = Token{ pos0, pos1 - pos0, type };
+	pos0 = pos1 + 1;
       }
-      
-      SearchState & createTransition(std::u32string_view pattern) {
-	if (pattern.empty()) {
-	  return *this;
+
+      // an OR is inserted between adjacent terms
+      std::array<Token, CAPACITY> stack{};
+      std::array<Token, 2 * CAPACITY> rpn{};
+      size_t stack_size = 0, rpn_size = 0;
+      bool is_or_inserted = false;
+      for (size_t i = 0; i < token_count || is_or_inserted; ) {
+	auto t = is_or_inserted ? Token{ 0, 0, TokenType::OR } : tokens[i++];
+	is_or_inserted = false;
+	bool op1 = isOperator(t.type);
+	if (i < token_count) {
+	  auto & t2 = tokens[i];
+	  bool op2 = isOperator(t2.type);
+	  if (op1 && op2) throw std::runtime_error("missing term");
+	  if (!op1 && t.type != TokenType::OPEN && !op2 && t2.type != TokenType::CLOSE) is_or_inserted = true;
+	}
+
+	if (op1 || t.type == TokenType::OPEN) {
+	  stack[stack_size++] = t;
+	} else if (t.type == TokenType::CLOSE) {
+	  while (stack_size && stack[stack_size - 1].type != TokenType::OPEN) rpn[rpn_size++] = stack[--stack_size];
+	  if (!stack_size) throw std::runtime_error("mismatched parentheses");
+	  stack_size--;
 	} else {
-	  auto child = addTransition(std::make_unique<SearchState>(pattern.front()));
-	  return child->createTransition(pattern.substr(1));
+	  rpn[rpn_size++] = t;
 	}
       }
-      
-      char32_t character_;
-      SearchState * parent_ = nullptr;
-      SearchState * failure_transition_ = nullptr;
-      std::unordered_map< char32_t, std::unique_ptr<SearchState> > transitions_;
-      std::unordered_set<Node *> output_;
-    };
-    
-    void initialize() {
-      if (current_state_) {
-	// reset the state
-	expression_->reset();
-	current_pos_ = 0;
-	current_word_ = 0;
-      } else {
-	// extract all terms from search query
-	std::vector<std::pair<std::u32string, Node *>> terms;
-	expression_->getTerms(terms);
-	for (auto & [ term, node ] : terms) {
-	  root_.addPattern(term).addOutput(node);
+      while (stack_size) rpn[rpn_size++] = stack[--stack_size];
+
+      // an unmatched bracket is a term as in createNode()
+      Query q;
+      size_t depth = 0;
+      for (size_t i = 0; i < rpn_size; i++) {
+	auto & t = rpn[i];
+	if (isOperator(t.type)) {
+	  if (depth < 2) throw std::runtime_error("stack underflow");
+	  depth--;
+	  auto op = t.type == TokenType::AND ? Opcode::AND : t.type == TokenType::OR ? Opcode::OR : Opcode::AND_NOT;
+	  if (op == Opcode::AND_NOT) q.is_monotone = false;
+	  q.code[q.code_size++] = Instruction{ op, 0 };
+	} else {
+	  // the stack of the program is kept in the bits of a single word
+	  if (++depth > 64) throw std::runtime_error("expression is too deep for a static matcher");
+	  addTerm(q, line.substr(t.begin, t.size));
 	}
-	root_.computeFailureTransitions();
       }
-      current_state_ = &root_;
+      if (depth == 0) throw std::runtime_error("no tokens");
+      if (depth > 1) throw std::runtime_error("multiple node roots");
+      return q;
     }
 
-    // processes a string
-    void updateState(std::u32string s) {
-      bool prev_is_word = false;
+    static constexpr Query QUERY = parse();
 
-      for (auto c : s) {
-	auto is_word = isWordCharacter(c);
-	bool is_word_start = false;
-	if (!prev_is_word && is_word) {
-	  is_word_start = true;
-	  current_word_++;
-	}
-	if ((is_word_start || (prev_is_word && !is_word))) {
-	  updateState(BOUNDARY);
-	}
-	prev_is_word = is_word;
-
-	updateState(c);
-      }
-      
-      if (prev_is_word) {
-	updateState(BOUNDARY);
+    static constexpr uint64_t step(Instruction instruction, uint64_t stack, uint64_t hits) noexcept {
+      switch (instruction.op) {
+      case Opcode::TERM: return (stack << 1) | ((hits >> instruction.term) & 1);
+      case Opcode::CONSTANT: return (stack << 1) | 1;
+      case Opcode::AND: return ((stack >> 2) << 1) | ((stack >> 1) & stack & 1);
+      case Opcode::OR: return ((stack >> 2) << 1) | (((stack >> 1) | stack) & 1);
+      case Opcode::AND_NOT: return ((stack >> 2) << 1) | ((stack >> 1) & ~stack & 1);
       }
+      return stack;
     }
-    
-    // processes a single character
-    void updateState(char32_t character) {
-      auto pos = current_pos_;
-      if (character != BOUNDARY) current_pos_++;
 
-      auto new_state = current_state_->findTransition(character);
+    // runs the program with a loop at compile time
+    static constexpr bool run(uint64_t hits) noexcept {
+      uint64_t stack = 0;
+      for (size_t i = 0; i < QUERY.code_size; i++) stack = step(QUERY.code[i], stack, hits);
+      return stack & 1;
+    }
 
-      while (new_state == nullptr) {
-	if (current_state_ == &root_) break;
-	current_state_ = current_state_->getFailureTransition();
-	new_state = current_state_->findTransition(character);
-      }
-      
-      if (new_state) {
-	current_state_ = new_state;
-      
-	auto & output = current_state_->getOutput();
-	
-	for (auto node : output) {
-	  node->addMatch(pos, current_word_);
-	}
-      }
+    // runs the program as a sequence of inlined steps
+    template<size_t... I>
+    static bool run(uint64_t hits, std::index_sequence<I...>) noexcept {
+      uint64_t stack = 0;
+      ((stack = step(QUERY.code[I], stack, hits)), ...);
+      return stack & 1;
     }
 
-    // normalizes a string
-    static std::string normalize(std::string_view input) noexcept {
-      if (!input.empty()) {
-	utf8proc_uint8_t * dest = nullptr;
-	auto options = utf8proc_option_t(UTF8PROC_IGNORE | UTF8PROC_STRIPCC | UTF8PROC_CASEFOLD | UTF8PROC_COMPOSE);
-	auto s = utf8proc_map(reinterpret_cast<const unsigned char *>(input.data()),
-			      static_cast<utf8proc_ssize_t>(input.size()),
-			      &dest,
-			      options
-			      );
-	if (s >= 0) {
-	  std::string r(reinterpret_cast<char *>(dest), static_cast<size_t>(s));
-	  free(dest);
-	  return r;
-	} else {
-	  free(dest);
-	}
-      }
-      return std::string();
+    // the value of the expression for each set of term hits, and whether the value
+    // can change when more terms are found, for expressions of at most six terms
+    static constexpr bool HAS_TRUTH_TABLE = QUERY.term_count <= 6;
+
+    static constexpr uint64_t getTruthTable() noexcept {
+      uint64_t r = 0;
+      for (uint64_t hits = 0; hits < (uint64_t(1) << QUERY.term_count); hits++) r |= uint64_t(run(hits)) << hits;
+      return r;
     }
 
-    // tokenizes a string to words
-    static std::deque<std::string> tokenize(std::string_view line) {
-      std::deque<std::string> r;
-      
-      size_t pos0 = 0;
-      while (pos0 < line.size()) {
-	if (line[pos0] == ' ' || line[pos0] == '\t') {
-	  pos0++;
-	} else if (line[pos0] == '"') {
-	  pos0++;
-	  auto pos1 = line.find_first_of('"', pos0);
-	  if (pos1 == std::string_view::npos) pos1 = line.size();
-	  
-	  r.emplace_back(line.substr(pos0, pos1 - pos0));
-	  
-	  pos0 = pos1 + 1;
-	} else {
-	  auto pos1 = line.find_first_of(" \t", pos0);
-	  if (pos1 == std::string_view::npos) pos1 = line.size();
-	  
-	  if (pos0 < pos1) r.emplace_back(line.substr(pos0, pos1 - pos0));
-	  
-	  pos0 = pos1 + 1;
+    static constexpr uint64_t getDecided() noexcept {
+      uint64_t r = 0;
+      auto n = uint64_t(1) << QUERY.term_count;
+      for (uint64_t hits = 0; hits < n; hits++) {
+	bool is_decided = true;
+	for (auto superset = hits; superset < n; superset = (superset + 1) | hits) {
+	  if (run(superset) != run(hits)) is_decided = false;
 	}
+	r |= uint64_t(is_decided) << hits;
       }
-      
       return r;
     }
 
-    std::unique_ptr<Node> createNode(const std::string & t, std::vector<std::unique_ptr<Node>> & node_stack) {
-      if (t == "AND") return std::make_unique<And>(node_stack);
-      if (t == "OR") return std::make_unique<Or>(node_stack);
-      if (t == "NEAR") return std::make_unique<Near>(node_stack);
-      if (t == "ONEAR") return std::make_unique<Near>(node_stack, 0);
-      if (t == "NOT") return std::make_unique<AndNot>(node_stack);
-      auto t2 = normalize(t);
-      auto t3 = converter_.from_bytes(t2.data(), t2.data() + t2.size());
-      return std::make_unique<Term>(t2, t3);
+    static constexpr uint64_t TRUTH_TABLE = HAS_TRUTH_TABLE ? getTruthTable() : 0;
+    static constexpr uint64_t DECIDED = HAS_TRUTH_TABLE ? getDecided() : 0;
+
+    static bool evaluate(uint64_t hits) noexcept {
+      if constexpr (HAS_TRUTH_TABLE) return (TRUTH_TABLE >> hits) & 1;
+      else return run(hits, std::make_index_sequence<QUERY.code_size>());
     }
 
-    // creates a binary expression tree from a expression string
-    std::unique_ptr<Node> parse(std::string_view expression) {
-      // add spaces before and after brackets to ease tokenization
-      std::string e;
-      for (size_t i = 0; i < expression.size(); i++) {
-	auto c = expression[i];
-	if (c == '(' || c == ')') {
-	  if (!e.empty() && e.back() != ' ') e += ' ';
-	  e += c;
-	} else if (isspace(c)) {
-	  if (!e.empty() && e.back() != ' ') e += ' ';
-	} else {
-	  if (!e.empty() && (e.back() == '(' || e.back() == ')')) e += ' ';
-	  e += c;
-	}
+    // returns true if more term hits cannot change the value of the expression
+    static bool isDecided(uint64_t hits) noexcept {
+      if constexpr (HAS_TRUTH_TABLE) return (DECIDED >> hits) & 1;
+      else return QUERY.is_monotone && evaluate(hits);
+    }
+
+    // each byte of the patterns gets its own class, and class 0 is for the rest.
+    // ASCII upper case letters have the classes of the lower case letters.
+    static constexpr std::array<uint8_t, 256> getClasses() noexcept {
+      std::array<uint8_t, 256> r{};
+      uint8_t n = 1;
+      for (size_t i = 0; i < QUERY.patterns_size; i++) {
+	auto & cls = r[static_cast<unsigned char>(QUERY.patterns[i])];
+	if (!cls) cls = n++;
       }
+      for (size_t c = 'A'; c <= 'Z'; c++) r[c] = r[c + 0x20];
+      return r;
+    }
 
-      auto tokens = tokenize(e);
+    static constexpr size_t getClassCount() noexcept {
+      size_t r = 1;
+      for (auto cls : CLASSES) r = std::max(r, cls + size_t(1));
+      return r;
+    }
 
-      std::vector<std::string> stack, rpn;
-      while (!tokens.empty()) {
-	auto t = std::move(tokens.front());
-	tokens.pop_front();
+    static constexpr std::array<uint8_t, 256> CLASSES = getClasses();
+    static constexpr size_t CLASS_COUNT = getClassCount();
+    static constexpr size_t MAX_STATES = QUERY.patterns_size + 1;
 
-	bool op1 = t == "AND" || t == "OR" || t == "NEAR" || t == "ONEAR" || t == "NOT";
-	
-	if (!tokens.empty()) {
-	  auto & t2 = tokens.front();
-	  bool op2 = t2 == "AND" || t2 == "OR" || t2 == "NEAR" || t2 == "ONEAR" || t2 == "NOT";
-	  if (op1 && op2) throw std::runtime_error("missing term");
-	  if (!op1 && t != "(" && !op2 && t2 != ")") {
-	    tokens.push_front("OR");
-	  }
+    // the goto function of the patterns completed with the failure transitions,
+    // and the terms found in each state including those of its suffixes
+    struct Automaton {
+      std::array<uint32_t, MAX_STATES * CLASS_COUNT> transitions{};
+      std::array<uint64_t, MAX_STATES> outputs{};
+      size_t state_count = 1;
+    };
+
+    static constexpr Automaton buildAutomaton() noexcept {
+      Automaton a;
+      for (size_t term = 0, i = 0; term < QUERY.term_count; term++) {
+	uint32_t state = 0;
+	for (; i < QUERY.pattern_ends[term]; i++) {
+	  auto & next = a.transitions[state * CLASS_COUNT + CLASSES[static_cast<unsigned char>(QUERY.patterns[i])]];
+	  if (!next) next = static_cast<uint32_t>(a.state_count++);
+	  state = next;
 	}
-	
-	if (op1 || t == "(") {
-	  stack.push_back(t);
-	} else if (t == ")") {
-	  while (!stack.empty() && stack.back() != "(") {
-	    rpn.push_back(stack.back());
-	    stack.pop_back();
+	a.outputs[state] |= uint64_t(1) << term;
+      }
+      // the states are visited breadth-first, so that the failure state of a
+      // state is complete before the state itself
+      std::array<uint32_t, MAX_STATES> failures{}, queue{};
+      size_t head = 0, tail = 0;
+      for (size_t c = 0; c < CLASS_COUNT; c++) {
+	if (a.transitions[c]) queue[tail++] = a.transitions[c];
+      }
+      while (head < tail) {
+	auto state = queue[head++];
+	a.outputs[state] |= a.outputs[failures[state]];
+	for (size_t c = 0; c < CLASS_COUNT; c++) {
+	  auto & next = a.transitions[state * CLASS_COUNT + c];
+	  auto fallback = a.transitions[failures[state] * CLASS_COUNT + c];
+	  if (next) {
+	    failures[next] = fallback;
+	    queue[tail++] = next;
+	  } else {
+	    next = fallback;
 	  }
-	  if (stack.empty()) throw std::runtime_error("mismatched parentheses");
-	  stack.pop_back();
-	} else {
-	  rpn.push_back(t);
 	}
       }
+      return a;
+    }
 
-      while (!stack.empty()) {
-	rpn.push_back(stack.back());
-	stack.pop_back();
+    static constexpr Automaton AUTOMATON = buildAutomaton();
+    static constexpr size_t STATE_COUNT = AUTOMATON.state_count;
+    using State = std::conditional_t<(STATE_COUNT <= 0x100), uint8_t, std::conditional_t<(STATE_COUNT <= 0x10000), uint16_t, uint32_t>>;
+
+    static constexpr std::array<State, STATE_COUNT * CLASS_COUNT> getTransitions() noexcept {
+      std::array<State, STATE_COUNT * CLASS_COUNT> r{};
+      for (size_t i = 0; i < r.size(); i++) r[i] = static_cast<State>(AUTOMATON.transitions[i]);
+      return r;
+    }
+
+    static constexpr std::array<uint64_t, STATE_COUNT> getOutputs() noexcept {
+      std::array<uint64_t, STATE_COUNT> r{};
+      for (size_t i = 0; i < r.size(); i++) r[i] = AUTOMATON.outputs[i];
+      return r;
+    }
+
+    static constexpr std::array<State, STATE_COUNT * CLASS_COUNT> TRANSITIONS = getTransitions();
+    static constexpr std::array<uint64_t, STATE_COUNT> OUTPUTS = getOutputs();
+
+    // the bytes that leave the root state, directly or after a boundary, as in Automaton
+    static constexpr std::array<std::array<uint8_t, 16>, 2> getStartNibbles() noexcept {
+      std::array<std::array<uint8_t, 16>, 2> r{};
+      auto boundary_state = TRANSITIONS[CLASSES[static_cast<unsigned char>(BOUNDARY)]];
+      for (size_t c = 0; c < 0x80; c++) {
+	if (TRANSITIONS[CLASSES[c]]) r[0][c & 15] |= static_cast<uint8_t>(1 << (c >> 4));
+	if (TRANSITIONS[boundary_state * CLASS_COUNT + CLASSES[c]]) r[1][c & 15] |= static_cast<uint8_t>(1 << (c >> 4));
       }
-  
-      std::vector<std::unique_ptr<Node> > node_stack;
-      
-      for (auto & t : rpn) {
-	node_stack.push_back(createNode(t, node_stack));
+      return r;
+    }
+
+    static constexpr std::array<std::array<uint8_t, 16>, 2> START_NIBBLES = getStartNibbles();
+
+    // returns true if a text has no control characters or non-ASCII bytes
+    static bool isPrintableAscii(std::string_view s) noexcept {
+      size_t i = 0;
+#ifdef __SSE2__
+      for (; i + 16 <= s.size(); i += 16) {
+	auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s.data() + i));
+	// the bytes above 0x7f are negative
+	auto special = _mm_or_si128(_mm_cmplt_epi8(v, _mm_set1_epi8(0x20)), _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f)));
+	if (_mm_movemask_epi8(special)) return false;
       }
-      
-      if (node_stack.empty()) {
-	throw std::runtime_error("no tokens");
-      } else if (node_stack.size() > 1) {
-	throw std::runtime_error("multiple node roots");
-      } else {
-	return std::move(node_stack.back());
+#endif
+      for (; i < s.size(); i++) {
+	if (s[i] < 0x20 || s[i] == 0x7f) return false;
       }
+      return true;
     }
-    
-    std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> converter_;
 
-    int current_pos_ = 0, current_word_ = 0;
-    std::unique_ptr<Node> expression_;
-    
-    SearchState * current_state_ = nullptr;
-    SearchState root_;
+    // Runs the automaton over a text until the expression is decided. In the root
+    // state, ASCII blocks are skipped up to the first byte that can start a match.
+    static void scan(std::string_view s, uint64_t & hits) noexcept {
+      uint32_t state = 0;
+      auto prev_class = word_class::NON_WORD;
+#ifdef __SSSE3__
+      // blocks with non-ASCII bytes are processed one codepoint at a time up to scalar_end
+      size_t scalar_end = 0;
+#endif
+      for (size_t i = 0; i < s.size(); ) {
+#ifdef __SSSE3__
+	if (!state && i >= scalar_end && i + 16 <= s.size()) {
+	  auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s.data() + i));
+	  if (_mm_movemask_epi8(v)) {
+	    scalar_end = i + 16;
+	  } else {
+	    auto word = static_cast<uint32_t>(_mm_movemask_epi8(compiled_query::getAsciiWordMask(v)));
+	    auto boundary = (word ^ ((word << 1) | static_cast<uint32_t>(prev_class == word_class::WORD))) & 0xffff;
+	    if (prev_class == word_class::SINGLE) boundary |= 1;
+	    auto candidates = compiled_query::findStartBytes(v, START_NIBBLES[0]) | (compiled_query::findStartBytes(v, START_NIBBLES[1]) & boundary);
+	    auto n = candidates ? static_cast<uint32_t>(__builtin_ctz(candidates)) : 16u;
+	    if (n > 0) prev_class = (word >> (n - 1)) & 1 ? word_class::WORD : word_class::NON_WORD;
+	    i += n;
+	    if (!candidates) continue;
+	  }
+	}
+#endif
+	char32_t codepoint;
+	auto n = compiled_query::decodeCodepoint(s, i, codepoint);
+	auto cls = compiled_query::getWordClass(codepoint);
+	if (compiled_query::isBoundary(prev_class, cls) && update(state, BOUNDARY, hits)) return;
+	prev_class = cls;
+	for (auto end = i + n; i < end; i++) {
+	  if (update(state, s[i], hits)) return;
+	}
+      }
+      if (prev_class != word_class::NON_WORD) update(state, BOUNDARY, hits);
+    }
+
+    // processes a byte and returns true if the expression is decided
+    static bool update(uint32_t & state, char character, uint64_t & hits) noexcept {
+      state = TRANSITIONS[state * CLASS_COUNT + CLASSES[static_cast<unsigned char>(character)]];
+      auto output = OUTPUTS[state];
+      if (!(output & ~hits)) return false;
+      hits |= output;
+      return isDecided(hits);
+    }
+
+    std::string text_;
+    std::vector<utf8proc_int32_t> buffer_;
   };
+
+  template<const char * Expression>
+  using static_matcher = basic_static_matcher<Expression>;
+
+  using matcher = basic_matcher<>;
+  using matcher_set = basic_matcher_set<>;
 };
 
 #endif
@@ -0,0 +1,317 @@
+// Generated by scripts/generate_unicode_tables.py from Unicode 14.0.0. Do not edit.
+
+#ifndef _BOOLEAN_MATCHER_UNICODE_H_
+#define _BOOLEAN_MATCHER_UNICODE_H_
+
+#include <cstdint>
+
+namespace boolean_matcher {
+  namespace unicode {
+    // the index of the bitset of each block of 256 codepoints
+    inline constexpr uint8_t WORD_BLOCK_INDEX[4352] = {
+      0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,1,17,18,19,1,20,21,
+      22,23,24,25,26,27,1,28,29,30,31,31,31,31,31,31,31,31,31,31,32,33,34,31,
+      35,36,31,31,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,27,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,37,1,38,39,
+      40,41,42,43,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,44,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,1,45,46,1,47,48,49,50,31,51,52,53,54,1,55,
+      56,57,58,59,60,61,62,63,64,65,66,67,68,69,70,71,72,73,74,31,75,76,77,78,
+      1,1,1,79,80,81,31,31,31,31,31,31,31,31,31,82,1,1,1,1,83,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,1,1,84,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      1,1,85,86,31,31,87,88,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,1,1,89,1,1,1,1,90,91,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,92,
+      1,93,94,31,31,31,31,31,31,31,31,31,95,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,96,97,98,99,31,31,31,31,31,31,31,100,
+      31,101,102,31,31,31,31,103,104,105,31,31,31,31,106,31,31,31,31,31,31,31,31,31,
+      31,31,31,107,31,31,31,31,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,1,1,1,108,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,109,
+      110,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,111,1,
+      1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+      1,1,1,112,31,31,31,31,31,31,31,31,31,31,31,31,1,1,113,31,31,31,31,31,
+      1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,114,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
+      31,31,31,31,31,31,31,31,
+    };
+
+    // the word characters of each block as a bitset
+    inline constexpr uint64_t WORD_BLOCKS[115][4] = {
+      { 0x03ff000000000000u, 0x07fffffe87fffffeu, 0x0420040000000000u, 0xff7fffffff7fffffu },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0x0000501f0003ffc3u },
+      { 0x0000000000000000u, 0xbcdf000000000000u, 0xfffffffbffffd740u, 0xffbfffffffffffffu },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xfffffffffffffc03u, 0xffffffffffffffffu },
+      { 0xfffeffffffffffffu, 0xffffffff027fffffu, 0x00000000000001ffu, 0x000787ffffff0000u },
+      { 0xffffffff00000000u, 0xfffec3ff000007ffu, 0xffffffffffffffffu, 0x9fffc060002fffffu },
+      { 0x0000fffffffd0000u, 0xffffffffffffe000u, 0x0002003fffffffffu, 0x043007ffffffffffu },
+      { 0x00000110043fffffu, 0xffff07ff01ffffffu, 0xffffffff00007effu, 0x00000000000003ffu },
+      { 0x23fffffffffffff0u, 0xfffeffc3ff010000u, 0x23c5fdfffff99fe1u, 0x1003ffc3b0004000u },
+      { 0x036dfdfffff987e0u, 0x001cffc05e000000u, 0x23edfdfffffbbfe0u, 0x0200ffc300010000u },
+      { 0x23edfdfffff99fe0u, 0x0002ffc3b0000000u, 0x03ffc718d63dc7e8u, 0x0000ffc000010000u },
+      { 0x23fffdfffffddfe0u, 0x0000ffc327000000u, 0x23effdfffffddfe1u, 0x0006ffc360000000u },
+      { 0x27fffffffffddff0u, 0xfc00ffc380704000u, 0x2ffbfffffc7fffe0u, 0x0000ffc00000007fu },
+      { 0x000dfffffffffffeu, 0x0000000003ff007fu, 0x200dffaffffff7d6u, 0x00000000f3ff005fu },
+      { 0x000003ff00000001u, 0x00001ffffffffeffu, 0x0000000000001f00u, 0x0000000000000000u },
+      { 0x800007ffffffffffu, 0xffe1c0623c3f03ffu, 0xffffffff03ff4003u, 0xf7ffffffffff20bfu },
+      { 0xffffffffffffffffu, 0xffffffff3d7f3dffu, 0x7f3dffffffff3dffu, 0xffffffffff7fff3du },
+      { 0xffffffffff3dffffu, 0x0000000007ffffffu, 0xffffffff0000ffffu, 0x3f3fffffffffffffu },
+      { 0xfffffffffffffffeu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu },
+      { 0xffffffffffffffffu, 0xffff9fffffffffffu, 0xffffffff07fffffeu, 0x01fe07ffffffffffu },
+      { 0x0003ffff8003ffffu, 0x0001dfff0003ffffu, 0x000fffffffffffffu, 0x000003ff10800000u },
+      { 0xffffffff03ff0000u, 0x01ffffffffffffffu, 0xffff05ffffffff9fu, 0x003fffffffffffffu },
+      { 0x000000007fffffffu, 0x001f3fffffffffc0u, 0xffff0fffffffffffu, 0x0000000003ff03ffu },
+      { 0xffffffff007fffffu, 0x00000000001fffffu, 0x0000008003ff03ffu, 0x0000000000000000u },
+      { 0x000fffffffffffe0u, 0x0000000003ff1fe0u, 0xffffc001fffffff8u, 0x0000003fffffffffu },
+      { 0x0000000fffffffffu, 0x3fffffffffffe3ffu, 0xe7ffffffffff01ffu, 0x046fde0000000000u },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0x0000000000000000u },
+      { 0xffffffff3f3fffffu, 0x3fffffffaaff3f3fu, 0x5fdfffffffffffffu, 0x1fdc1fff0fcf1fdcu },
+      { 0x8000000000000000u, 0x8002000000100001u, 0x000000001fff0000u, 0x0000000000000000u },
+      { 0xf3ffbd503e2ffc84u, 0x00000000000043e0u, 0x0000000000000018u, 0x0000000000000000u },
+      { 0x0000000000000000u, 0x0000000000000000u, 0x0000000000000000u, 0x0000000000000000u },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0x000c781fffffffffu },
+      { 0xffff20bfffffffffu, 0x000080ffffffffffu, 0x7f7f7f7f007fffffu, 0x000000007f7f7f7fu },
+      { 0x0000800000000000u, 0x0000000000000000u, 0x0000000000000000u, 0x0000000000000000u },
+      { 0x183e000000000060u, 0xfffffffffffffffeu, 0xfffffffee07fffffu, 0xf7ffffffffffffffu },
+      { 0xfffeffffffffffe0u, 0xffffffffffffffffu, 0xffffffff00007fffu, 0xffff000000000000u },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0x0000000000001fffu, 0x3fffffffffff0000u },
+      { 0x00000fffffff1fffu, 0x80007fffffffffffu, 0xffffffff3fffffffu, 0x0000003fffffffffu },
+      { 0xfffffffcff800000u, 0xffffffffffffffffu, 0xfffffffffffff9ffu, 0xfffc000003eb07ffu },
+      { 0x00000007fffff7bbu, 0x000fffffffffffffu, 0x000ffffffffffffcu, 0x68fc000003ff0000u },
+      { 0xffff003fffffffffu, 0x1fffffff0000007fu, 0x0007fffffffffff0u, 0x7fffffdf03ff8000u },
+      { 0x000001ffffffffffu, 0xc47fffff03ff0ff7u, 0x3e62ffffffffffffu, 0x001c07ff38000005u },
+      { 0xffff7f7f007e7e7eu, 0xffff03fff7ffffffu, 0xffffffffffffffffu, 0x03ff0007ffffffffu },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffff000fffffffffu, 0x0ffffffffffff87fu },
+      { 0xffffffffffffffffu, 0xffff3fffffffffffu, 0xffffffffffffffffu, 0x0000000003ffffffu },
+      { 0x5f7ffdffa0f8007fu, 0xffffffffffffffdbu, 0x0003ffffffffffffu, 0xfffffffffff80000u },
+      { 0x3fffffffffffffffu, 0xffffffffffff0000u, 0xfffffffffffcffffu, 0x0fff0000000000ffu },
+      { 0x0018000000000000u, 0xffdf00000000e000u, 0xffffffffffffffffu, 0x1fffffffffffffffu },
+      { 0x87fffffe03ff0000u, 0xffffffc007fffffeu, 0x7fffffffffffffffu, 0x000000001cfcfcfcu },
+      { 0xb7ffff7fffffefffu, 0x000000003fff3fffu, 0xffffffffffffffffu, 0x07ffffffffffffffu },
+      { 0x0000000000000000u, 0x0000000000000000u, 0xffffffff1fffffffu, 0x000000000001ffffu },
+      { 0xffffe000ffffffffu, 0x003fffffffff03fdu, 0xffffffff3fffffffu, 0x000000000000ff0fu },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffff03ff3fffffffu, 0x0fffffffff0fffffu },
+      { 0xffff00ffffffffffu, 0xf7ff000fffffffffu, 0x1bfbfffbffb7f7ffu, 0x0000000000000000u },
+      { 0x007fffffffffffffu, 0x000000ff003fffffu, 0x07fdffffffffffbfu, 0x0000000000000000u },
+      { 0x91bffffffffffd3fu, 0x007fffff003fffffu, 0x000000007fffffffu, 0x0037ffff00000000u },
+      { 0x03ffffff003fffffu, 0x0000000000000000u, 0xc0ffffffffffffffu, 0x0000000000000000u },
+      { 0x003ffffffeef0001u, 0x1fffffff00000000u, 0x000000001fffffffu, 0x0000001ffffffeffu },
+      { 0x003fffffffffffffu, 0x0007ffff003fffffu, 0x000000000003ffffu, 0x0000000000000000u },
+      { 0xffffffffffffffffu, 0x00000000000001ffu, 0x0007ffffffffffffu, 0x0007ffffffffffffu },
+      { 0x03ff000fffffffffu, 0x0000000000000000u, 0x0000000000000000u, 0x0000000000000000u },
+      { 0x0000000000000000u, 0x0000000000000000u, 0x000303ffffffffffu, 0x0000000000000000u },
+      { 0xffff00801fffffffu, 0xffff00000000003fu, 0xffff000000000003u, 0x007fffff0000001fu },
+      { 0x00fffffffffffff8u, 0x0026ffc000000000u, 0x0000fffffffffff8u, 0x03ff01ffffff0000u },
+      { 0xffc0007ffffffff8u, 0x0047ffffffff0090u, 0x0007fffffffffff8u, 0x0000000017ff001eu },
+      { 0x00000ffffffbffffu, 0x0000000000000000u, 0xffff01ffbfffbd7fu, 0x03ff00007fffffffu },
+      { 0x23edfdfffff99fe0u, 0x00000003e0010000u, 0x0000000000000000u, 0x0000000000000000u },
+      { 0x001fffffffffffffu, 0x0000000383ff0780u, 0x0000ffffffffffffu, 0x0000000003ff00b0u },
+      { 0x0000000000000000u, 0x0000000000000000u, 0x00007fffffffffffu, 0x000000000f000000u },
+      { 0x0000ffffffffffffu, 0x0000000003ff0010u, 0x010007ffffffffffu, 0x00000000000003ffu },
+      { 0x03ff000007ffffffu, 0x000000000000007fu, 0x0000000000000000u, 0x0000000000000000u },
+      { 0x00000fffffffffffu, 0x0000000000000000u, 0xffffffff00000000u, 0x800003ffffffffffu },
+      { 0x8000ffffff6ff27fu, 0x0000000003ff0002u, 0xfffffcff00000000u, 0x0000000a0001ffffu },
+      { 0x0407fffffffff801u, 0xfffffffff0010000u, 0xffff0000200003ffu, 0x01ffffffffffffffu },
+      { 0x00007ffffffffdffu, 0xfffc000003ff0001u, 0x000000000000ffffu, 0x0000000000000000u },
+      { 0x0001fffffffffb7fu, 0xfffffdbf03ff0040u, 0x000003ff010003ffu, 0x0000000000000000u },
+      { 0x0000000000000000u, 0x0000000000000000u, 0x0000000000000000u, 0x0007ffff00000000u },
+      { 0x0000000000000000u, 0x0000000000000000u, 0x0001000000000000u, 0x0000000000000000u },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0x0000000003ffffffu, 0x0000000000000000u },
+      { 0x0000000000000000u, 0x0000000000000000u, 0xffffffffffffffffu, 0xffffffffffffffffu },
+      { 0xffffffffffffffffu, 0x000000000000000fu, 0x0000000000000000u, 0x0000000000000000u },
+      { 0x0000000000000000u, 0x0000000000000000u, 0xffffffffffff0000u, 0x0001ffffffffffffu },
+      { 0x00007fffffffffffu, 0x0000000000000000u, 0x0000000000000000u, 0x0000000000000000u },
+      { 0xffffffffffffffffu, 0x000000000000007fu, 0x0000000000000000u, 0x0000000000000000u },
+      { 0x01ffffffffffffffu, 0xffff03ff7fffffffu, 0x7fffffffffffffffu, 0x00003fffffff03ffu },
+      { 0x0000ffffffffffffu, 0xe0fffff803ff000fu, 0x000000000000ffffu, 0x0000000000000000u },
+      { 0x0000000000000000u, 0xffffffffffffffffu, 0x0000000000000000u, 0x0000000000000000u },
+      { 0xffffffffffffffffu, 0x00000000000107ffu, 0x00000000fff80000u, 0x0000000b00000000u },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0x00ffffffffffffffu },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0x00000000003fffffu },
+      { 0x00000000000001ffu, 0x0000000000000000u, 0x0000000000000000u, 0x0000000000000000u },
+      { 0x0000000000000000u, 0x0000000000000000u, 0x0000000000000000u, 0x6fef000000000000u },
+      { 0x00000007ffffffffu, 0xffff00f000070000u, 0xffffffffffffffffu, 0xffffffffffffffffu },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0x0fffffffffffffffu },
+      { 0xffffffffffffffffu, 0x1fff07ffffffffffu, 0x0000000003ff01ffu, 0x0000000000000000u },
+      { 0xffffffffffffffffu, 0xffffffffffdfffffu, 0xebffde64dfffffffu, 0xffffffffffffffefu },
+      { 0x7bffffffdfdfe7bfu, 0xfffffffffffdfc5fu, 0xffffffffffffffffu, 0xffffffffffffffffu },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffff3fffffffffu, 0xf7fffffff7fffffdu },
+      { 0xffdfffffffdfffffu, 0xffff7fffffff7fffu, 0xfffffdfffffffdffu, 0xffffffffffffcff7u },
+      { 0x000000007fffffffu, 0x0000000000000000u, 0x0000000000000000u, 0x0000000000000000u },
+      { 0x3f801fffffffffffu, 0x00000000000043ffu, 0x0000000000000000u, 0x0000000000000000u },
+      { 0x0000000000000000u, 0x0000000000000000u, 0x00003fffffff0000u, 0x03ff0fffffffffffu },
+      { 0x0000000000000000u, 0x0000000000000000u, 0x0000000000000000u, 0x7fff6f7f00000000u },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0x000000000000001fu },
+      { 0xffffffffffffffffu, 0x0000000003ff080fu, 0x0000000000000000u, 0x0000000000000000u },
+      { 0x0af7fe96ffffffefu, 0x5ef7f796aa96ea84u, 0x0ffffbee0ffffbffu, 0x0000000000000000u },
+      { 0x0000000000000000u, 0x0000000000000000u, 0x0000000000000000u, 0x03ff000000000000u },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0x00000000ffffffffu },
+      { 0x01ffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu },
+      { 0xffffffff3fffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffff0003ffffffffu, 0xffffffffffffffffu },
+      { 0xffffffffffffffffu, 0xffffffffffffffffu, 0xffffffffffffffffu, 0x00000001ffffffffu },
+      { 0x000000003fffffffu, 0x0000000000000000u, 0x0000000000000000u, 0x0000000000000000u },
+      { 0xffffffffffffffffu, 0x00000000000007ffu, 0x0000000000000000u, 0x0000000000000000u },
+    };
+  };
+};
+
+#endif
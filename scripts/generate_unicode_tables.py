@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+# Generates include/boolean_search_unicode.h, the word character tables of boolean_search
+#
+# usage: generate_unicode_tables.py > include/boolean_search_unicode.h
+
+import unicodedata
+
+# the general categories of word characters: letters, decimal digits and connector punctuation
+WORD_CATEGORIES = { 'Lu', 'Ll', 'Lt', 'Lm', 'Lo', 'Nd', 'Pc' }
+BLOCK_SIZE = 256
+
+def is_word(codepoint):
+    return unicodedata.category(chr(codepoint)) in WORD_CATEGORIES
+
+def get_words(block):
+    words = [ 0, 0, 0, 0 ]
+    for i in range(BLOCK_SIZE):
+        if is_word(block * BLOCK_SIZE + i):
+            words[i >> 6] |= 1 << (i & 63)
+    return tuple(words)
+
+blocks = {}
+index = []
+for block in range(0x110000 // BLOCK_SIZE):
+    words = get_words(block)
+    if words not in blocks:
+        blocks[words] = len(blocks)
+    index.append(blocks[words])
+assert len(blocks) <= 256
+
+print('''// Generated by scripts/generate_unicode_tables.py from Unicode %s. Do not edit.
+
+#ifndef _BOOLEAN_MATCHER_UNICODE_H_
+#define _BOOLEAN_MATCHER_UNICODE_H_
+
+#include <cstdint>
+
+namespace boolean_matcher {
+  namespace unicode {
+    // the index of the bitset of each block of %d codepoints
+    inline constexpr uint8_t WORD_BLOCK_INDEX[%d] = {''' % (unicodedata.unidata_version, BLOCK_SIZE, len(index)))
+for i in range(0, len(index), 24):
+    print('      ' + ''.join('%d,' % v for v in index[i:i + 24]))
+print('''    };
+
+    // the word characters of each block as a bitset
+    inline constexpr uint64_t WORD_BLOCKS[%d][4] = {''' % len(blocks))
+for words in blocks:
+    print('      { ' + ', '.join('0x%016xu' % w for w in words) + ' },')
+print('''    };
+  };
+};
+
+#endif''')
@@ -3,6 +3,11 @@
 #include "boolean_search.h"
 
 #include <iostream>
+#include <thread>
+#include <fstream>
+#include <cstdio>
+#include <tuple>
+#include <iterator>
 
 TEST_CASE( "expression with term only", "[term]" ) {
   boolean_matcher::matcher m("hello");
@@ -121,3 +126,760 @@ TEST_CASE( "implicit ORs", "[implicit_or]" ) {
   REQUIRE(m.match("world hello") == true);
   REQUIRE(m.match("orange") == false);
 }
+
+TEST_CASE( "matcher set", "[matcher_set]" ) {
+  boolean_matcher::matcher_set s;
+  auto apple = s.add("apple AND orange");
+  auto war = s.add("war OR peace");
+  auto one = s.add("one NOT two");
+  auto hello = s.add("hello*");
+  REQUIRE(s.size() == 4);
+
+  REQUIRE(s.match("I've got an apple and an orange") == std::vector<size_t>{ apple });
+  REQUIRE(s.match("One war, two oranges") == std::vector<size_t>{ war });
+  REQUIRE(s.match("Hellooo, one apple and peace") == std::vector<size_t>{ war, one, hello });
+  REQUIRE(s.match("nothing here").empty());
+
+  auto world = s.add("world");
+  REQUIRE(s.match("hello world") == std::vector<size_t>{ hello, world });
+}
+
+TEST_CASE( "overlapping terms", "[automaton]" ) {
+  boolean_matcher::matcher m("\"she sells\" AND (hers OR \"he sells shells\")");
+  REQUIRE(m.match("she sells sea shells") == false);
+  REQUIRE(m.match("she sells hers") == true);
+  REQUIRE(m.match("ushe sells hers") == false);
+  REQUIRE(m.match("she he sells shells") == false);
+  REQUIRE(m.match("he sells shells, she sells shells") == true);
+
+  boolean_matcher::matcher m2("café AND ÆBLE");
+  REQUIRE(m2.match("Café æble") == true);
+  REQUIRE(m2.match("cafe æble") == false);
+
+  // the outputs of suffixes are found through the output links
+  boolean_matcher::matcher_set s;
+  for (auto e : { "*abcd", "*bcd", "*cd", "*d", "*bc", "xabcd" }) s.add(e);
+  REQUIRE(s.match("xabcd") == std::vector<size_t>({ 0, 1, 2, 3, 5 }));
+  REQUIRE(s.match("bcd") == std::vector<size_t>({ 1, 2, 3 }));
+  REQUIRE(s.match("abc") == std::vector<size_t>({ 4 }));
+  REQUIRE(s.match("dabc") == std::vector<size_t>({ 4 }));
+}
+
+TEST_CASE( "UTF-8 text", "[utf8]" ) {
+  boolean_matcher::matcher m("\"Ääni kuuluu\" NEAR hyvin");
+  REQUIRE(m.match("Äänı kuuluu hyvin") == false);
+  REQUIRE(m.match("ÄÄNI KUULUU HYVIN") == true);
+  REQUIRE(m.match("Ääni kuuluu äärimmäisen hyvin") == true);
+
+  boolean_matcher::matcher m2("kuuluu");
+  auto r = m2.search("Ääni ei kuulu. Ääni kuuluu nyt täällä melko hyvin.");
+  REQUIRE(r.has_match());
+  REQUIRE(r.get_hit_sentence().find("Ääni kuuluu nyt täällä") != std::string::npos);
+}
+
+TEST_CASE( "normalization", "[normalization]" ) {
+  boolean_matcher::matcher m("\"hello world\" AND café");
+  REQUIRE(m.match("HELLO WORLD, CAFÉ") == true);
+  REQUIRE(m.match("Hello\tWorld, Cafe\xcc\x81") == true);
+  REQUIRE(m.match("Hello\r\nWorld, Cafe\x01\xcc\x81") == true);
+  REQUIRE(m.match("Hello\r\n\nWorld, café") == false);
+  REQUIRE(m.match("Hel\x7flo wor\x02ld from an ordinary ASCII only café!") == true);
+  REQUIRE(m.match("A long line of plain ASCII text that says HELLO WORLD to the CAF\xc3\x89") == true);
+  REQUIRE(m.match("hello world caf\xe9") == false);
+}
+
+TEST_CASE( "streaming", "[streaming]" ) {
+  boolean_matcher::matcher m("\"hello world\" NEAR café");
+  std::string text = "Hello\r\nWorld, a cafe\xcc\x81 or tea?";
+  REQUIRE(m.match(text) == true);
+
+  // feed the text in chunks of every size, splitting UTF-8 sequences, CR LF and combining characters
+  for (size_t size = 1; size <= text.size(); size++) {
+    m.begin();
+    for (size_t i = 0; i < text.size(); i += size) {
+      m.feed(std::string_view(text).substr(i, size));
+    }
+    REQUIRE(m.finish() == true);
+  }
+
+  m.begin();
+  m.feed("Hello wor");
+  m.feed("ldly café");
+  REQUIRE(m.finish() == false);
+}
+
+TEST_CASE( "shared compiled query", "[compiled_query]" ) {
+  auto query = std::make_shared<const boolean_matcher::compiled_query>("(apple AND orange) OR \"hello world*\"");
+  std::vector<std::string> texts = { "an apple and an orange", "just an apple", "Hello worlds!", "hello there world" };
+  std::vector<bool> expected = { true, false, true, false };
+
+  std::vector<std::thread> threads;
+  std::vector<int> failures(4, 0);
+  for (size_t t = 0; t < failures.size(); t++) {
+    threads.emplace_back([&, t]() {
+      boolean_matcher::scan_context context;
+      for (int i = 0; i < 1000; i++) {
+	auto k = (t + static_cast<size_t>(i)) % texts.size();
+	if (query->match(texts[k], context) != expected[k]) failures[t]++;
+      }
+    });
+  }
+  for (auto & thread : threads) thread.join();
+  for (auto f : failures) REQUIRE(f == 0);
+
+  boolean_matcher::compiled_query set(std::vector<std::string>{ "apple", "orange NOT apple", "world*" });
+  boolean_matcher::scan_context context;
+  REQUIRE(set.size() == 3);
+  REQUIRE(set.match_all("an orange and a new world", context) == std::vector<size_t>{ 1, 2 });
+  REQUIRE(set.match("an orange and a new world", context) == false);
+}
+
+TEST_CASE( "batch matching", "[batch]" ) {
+  boolean_matcher::matcher m("(apple AND orange) OR \"hello world\"");
+  boolean_matcher::thread_pool pool(4);
+
+  std::vector<std::string> texts;
+  for (int i = 0; i < 1000; i++) {
+    switch (i % 4) {
+    case 0: texts.push_back("an apple and an orange"); break;
+    case 1: texts.push_back("just an apple"); break;
+    case 2: texts.push_back(std::string(static_cast<size_t>(i) * 10, 'x') + " hello world"); break;
+    default: texts.push_back("hello there world"); break;
+    }
+  }
+
+  for (int round = 0; round < 3; round++) {
+    auto r = m.match_batch(texts, pool);
+    REQUIRE(r.size() == texts.size());
+    for (size_t i = 0; i < texts.size(); i++) {
+      REQUIRE(r[i] == (i % 4 == 0 || i % 4 == 2));
+    }
+  }
+
+  auto results = m.search_batch(std::vector<std::string_view>{ "hello world", "goodbye" }, pool);
+  REQUIRE(results.size() == 2);
+  REQUIRE(results[0].has_match());
+  REQUIRE(!results[1].has_match());
+
+  REQUIRE(m.match_batch(std::vector<std::string>(), pool).empty());
+
+  // a task can use the same pool, which then runs the inner loop inline
+  std::atomic<size_t> found(0);
+  pool.for_each(8, [&](size_t i, boolean_matcher::scan_context & context) {
+    auto r = m.match_batch(texts, pool);
+    found += static_cast<size_t>(std::count(r.begin(), r.end(), true));
+    found += m.get_query()->match(texts[i], context, pool, 16);
+  });
+  REQUIRE(found == 8 * 500 + 4);
+}
+
+TEST_CASE( "early termination", "[early]" ) {
+  boolean_matcher::matcher m("(apple OR pear) NOT (banana OR \"rotten fruit\")");
+  REQUIRE(m.match("apple pear banana") == false);
+  REQUIRE(m.match("apple pear rotten fruit") == false);
+  REQUIRE(m.match("apple pear rotten, fruit") == true);
+  REQUIRE(m.match("banana") == false);
+
+  boolean_matcher::matcher m2("apple NEAR (pear NOT banana)");
+  REQUIRE(m2.match("apple pear") == true);
+  REQUIRE(m2.match("apple pear banana") == false);
+  REQUIRE(m2.match("apple and a pear and an apple") == true);
+
+  // a positional expression is not evaluated again on every match
+  boolean_matcher::matcher m4("a NEAR/1 b");
+  std::string text;
+  for (int i = 0; i < 50000; i++) text += "a x ";
+  for (int i = 0; i < 50000; i++) text += "b ";
+  REQUIRE(m4.match(text) == false);
+  REQUIRE(m4.search(text).has_match() == false);
+  REQUIRE(m4.match(text + "a") == true);
+  REQUIRE(m4.match("a b " + text) == true);
+
+  boolean_matcher::matcher m3("apple OR pear");
+  m3.begin();
+  m3.feed("an apple ");
+  m3.feed("and a pear");
+  REQUIRE(m3.finish() == true);
+  REQUIRE(m3.search("an apple and a pear").has_match());
+}
+
+TEST_CASE( "NEAR with distance", "[near_distance]" ) {
+  boolean_matcher::matcher m("happy NEAR/1 human");
+  REQUIRE(m.match("a happy human") == true);
+  REQUIRE(m.match("a human, happy") == true);
+  REQUIRE(m.match("a happy old human") == false);
+
+  boolean_matcher::matcher m2("beautiful ONEAR/2 Martian");
+  REQUIRE(m2.match("a beautiful green Martian") == true);
+  REQUIRE(m2.match("a beautiful and green Martian") == false);
+  REQUIRE(m2.match("Martian is beautiful") == false);
+
+  boolean_matcher::matcher m3("(apple OR pear) NEAR/0 (apple OR pear)");
+  REQUIRE(m3.match("apple") == true);
+
+  boolean_matcher::matcher m4("(cat OR dog) NEAR/2 (mouse OR bone)");
+  auto r = m4.search("cat dog x mouse x x x x x x bone");
+  REQUIRE(r.has_match());
+  REQUIRE(r.get_hit_sentence().find("dog x mouse") != std::string::npos);
+  REQUIRE(m4.match("cat x x x mouse x x x dog") == false);
+
+  REQUIRE_THROWS(boolean_matcher::matcher("a NEAR/ b"));
+  REQUIRE_THROWS(boolean_matcher::matcher("a NEAR/x b"));
+}
+
+TEST_CASE( "compiled expressions", "[program]" ) {
+  // small expressions are evaluated with a truth table
+  boolean_matcher::matcher m("(a OR b) AND (c OR d) NOT (e AND f)");
+  REQUIRE(m.match("a d") == true);
+  REQUIRE(m.match("a b") == false);
+  REQUIRE(m.match("b c e") == true);
+  REQUIRE(m.match("b c e f") == false);
+
+  // long implicit ORs are evaluated with a flat program
+  std::string expression = "((y1 NEAR y2) AND y3) OR (";
+  for (int i = 0; i < 100; i++) expression += "w" + std::to_string(i) + " ";
+  expression += ") NOT (x1 OR x2)";
+  boolean_matcher::matcher m2(expression);
+  REQUIRE(m2.match("w99") == true);
+  REQUIRE(m2.match("w0 x2") == false);
+  REQUIRE(m2.match("w100") == false);
+  REQUIRE(m2.match("y1 y2 y3") == true);
+  REQUIRE(m2.match("y1 y2 x1") == false);
+  REQUIRE(m2.match("y1 a b c d e f g y2 y3") == false);
+}
+
+TEST_CASE( "saved query", "[save]" ) {
+  std::vector<std::string> expressions = { "apple AND (pear OR \"green grape\")", "happy NEAR/1 human", "beautiful ONEAR Martian", "*fruit* NOT banana", "colo*r" };
+  boolean_matcher::compiled_query query(expressions);
+  auto filename = "boolean_search_test.query";
+  query.save(filename);
+  auto loaded = boolean_matcher::compiled_query::load(filename);
+  REQUIRE(loaded->size() == expressions.size());
+
+  boolean_matcher::scan_context context;
+  for (auto text : { "an apple and a green grape", "a happy human", "a beautiful Martian", "Martian beautiful", "grapefruits", "apple pear banana fruit", "a colourful colour" }) {
+    REQUIRE(loaded->match_all(text, context) == query.match_all(text, context));
+  }
+
+  boolean_matcher::matcher m(loaded);
+  REQUIRE(m.match("apple and pear") == true);
+  REQUIRE(m.search("an apple and a pear").has_match());
+
+  // a file whose term ids do not match the automaton is rejected
+  boolean_matcher::compiled_query("apple OR pear").save(filename);
+  std::string data;
+  {
+    std::ifstream in(filename, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  auto pos = data.find("pear");
+  REQUIRE(pos != std::string::npos);
+  data[pos - 8] = 0;
+  std::ofstream(filename, std::ios::binary | std::ios::trunc) << data;
+  REQUIRE_THROWS(boolean_matcher::compiled_query::load(filename));
+
+  std::ofstream(filename, std::ios::binary) << "not a query";
+  REQUIRE_THROWS(boolean_matcher::compiled_query::load(filename));
+  std::remove(filename);
+  REQUIRE_THROWS(boolean_matcher::compiled_query::load(filename));
+}
+
+TEST_CASE( "profiling", "[profile]" ) {
+  boolean_matcher::matcher m("((apple OR pear) AND orange) NOT banana");
+  REQUIRE(m.match("an apple and an orange") == true);
+  REQUIRE(m.match("a pear") == false);
+  auto & statistics = m.get_statistics();
+  if (boolean_matcher::PROFILING) {
+    REQUIRE(statistics.texts_ == 2);
+    REQUIRE(statistics.bytes_ == 28);
+    REQUIRE(statistics.codepoints_ == 28);
+    REQUIRE(statistics.term_matches_ == 3);
+  } else {
+    REQUIRE(statistics.texts_ == 0);
+  }
+
+  std::vector<std::string> texts = { "apple orange", "pear orange banana", "orange", "apple apple" };
+  auto profile = m.profile(texts);
+  REQUIRE(profile.size() == 7);
+  REQUIRE(profile[0].depth_ == 0);
+  REQUIRE(profile[0].evaluations_ == 4);
+  REQUIRE(profile[0].hits_ == 1);
+  // the preorder is NOT, AND, OR, apple, pear, orange, banana
+  REQUIRE(profile[1].hits_ == 2);
+  REQUIRE(profile[2].depth_ == 2);
+  REQUIRE(profile[2].hits_ == 3);
+  REQUIRE(profile[3].expression_ == "apple");
+  REQUIRE(profile[3].matches_ == 3);
+  REQUIRE(profile[6].expression_ == "banana");
+  REQUIRE(profile[6].hits_ == 1);
+}
+
+TEST_CASE( "prefilter", "[prefilter]" ) {
+  // the word indices must be counted in the skipped text
+  boolean_matcher::matcher m("alpha NEAR/4 omega");
+  REQUIRE(m.match("alpha, the quick_brown fox... omega") == true);
+  REQUIRE(m.match("alpha, the quick brown fox... omega") == false);
+  REQUIRE(m.match("alpha x1 x2 x3 ärger omega") == false);
+  REQUIRE(m.match("alpha x1 ärger omega") == true);
+  REQUIRE(m.match("xalpha xx omega") == false);
+  REQUIRE(m.match("lorem ipsum dolor sit amet, consectetur adipiscing elit alpha sed do omega") == true);
+
+  // the start of a word after a skipped block
+  std::string text(100, ' ');
+  text += "alpha";
+  text += std::string(37, '.');
+  text += "omega";
+  REQUIRE(m.match(text) == true);
+  REQUIRE(m.search(text).get_hit_sentence().find("alpha") != std::string::npos);
+
+  // a leading wildcard can start inside a word
+  boolean_matcher::matcher m2("*berry AND *apple*");
+  REQUIRE(m2.match("the blackberry and the pineapples are in the kitchen, next to the blueberries") == true);
+  REQUIRE(m2.match("the blackberry and the pineapple") == true);
+  REQUIRE(m2.match("the blackberries and the pineapples") == false);
+
+  // the skipped state is carried between chunks
+  m.begin();
+  for (auto chunk : { "alp", "ha and the x 0123456789abcdefghij", " om", "ega" }) m.feed(chunk);
+  REQUIRE(m.finish() == false);
+  m.begin();
+  for (auto chunk : { "alp", "ha and then", " ", "", "om", "ega" }) m.feed(chunk);
+  REQUIRE(m.finish() == true);
+
+  if (boolean_matcher::PROFILING) {
+    REQUIRE(m.get_statistics().skipped_bytes_ > 0);
+  }
+}
+
+TEST_CASE( "interior wildcards", "[wildcards]" ) {
+  boolean_matcher::matcher m("colo*r");
+  REQUIRE(m.match("colour") == true);
+  REQUIRE(m.match("Color") == true);
+  REQUIRE(m.match("colouring") == false);
+  REQUIRE(m.match("discolour") == false);
+  REQUIRE(m.match("colo r") == false);
+  REQUIRE(m.match("colo-r") == false);
+  REQUIRE(m.match("col") == false);
+  REQUIRE(m.match("colo blue r") == false);
+
+  boolean_matcher::matcher m2("an*lys*s");
+  REQUIRE(m2.match("analysis") == true);
+  REQUIRE(m2.match("analyses") == true);
+  REQUIRE(m2.match("anlyss") == true);
+  REQUIRE(m2.match("analyse") == false);
+  REQUIRE(m2.match("anal yses") == false);
+  // the fragments cannot overlap
+  REQUIRE(m2.match("anlys") == false);
+
+  boolean_matcher::matcher m3("*b*d*");
+  REQUIRE(m3.match("abcde") == true);
+  REQUIRE(m3.match("bd") == true);
+  REQUIRE(m3.match("db") == false);
+  REQUIRE(m3.match("ab cd") == false);
+
+  // a wildcard next to a non-word character is literal
+  boolean_matcher::matcher m4("\"a * b\"");
+  REQUIRE(m4.match("a * b") == true);
+  REQUIRE(m4.match("a x b") == false);
+
+  boolean_matcher::matcher m5("w*d NEAR/1 pe*ce");
+  REQUIRE(m5.match("the word and peace") == false);
+  REQUIRE(m5.match("the world peace") == true);
+  REQUIRE(m5.match("wood, peace") == true);
+  auto r = m5.search("a wild peace of cake");
+  REQUIRE(r.has_match());
+  REQUIRE(r.get_hit_sentence().find("wild peace") != std::string::npos);
+
+  // each match of a fragment is joined separately
+  boolean_matcher::matcher m6("*a*b");
+  REQUIRE(m6.match("aab") == true);
+  REQUIRE(m6.match("xaxaxb") == true);
+  REQUIRE(m6.match("ba") == false);
+
+  boolean_matcher::matcher_set s;
+  s.add("colo*r");
+  s.add("c*r NOT car");
+  REQUIRE(s.match("colour") == std::vector<size_t>({ 0, 1 }));
+  REQUIRE(s.match("car") == std::vector<size_t>());
+
+  m.begin();
+  for (auto chunk : { "the co", "lou", "r" }) m.feed(chunk);
+  REQUIRE(m.finish() == true);
+}
+
+TEST_CASE( "tokenizers", "[tokenizer]" ) {
+  REQUIRE(boolean_matcher::is_word_character(U'a'));
+  REQUIRE(boolean_matcher::is_word_character(U'_'));
+  REQUIRE(boolean_matcher::is_word_character(U'é'));
+  REQUIRE(boolean_matcher::is_word_character(U'ж'));
+  REQUIRE(boolean_matcher::is_word_character(U'中'));
+  REQUIRE(boolean_matcher::is_word_character(U'٣'));
+  REQUIRE(!boolean_matcher::is_word_character(U' '));
+  REQUIRE(!boolean_matcher::is_word_character(U'—'));
+  REQUIRE(!boolean_matcher::is_word_character(U'́'));
+  REQUIRE(!boolean_matcher::is_word_character(0x10ffff));
+  REQUIRE(!boolean_matcher::is_word_character(0x110000));
+
+  // a run of ideographs is a single word by default
+  boolean_matcher::matcher m("東京 NEAR/1 大学");
+  REQUIRE(m.match("東京 大学") == true);
+  REQUIRE(m.match("我在東京大学工作") == false);
+
+  // and each ideograph is a word with the CJK tokenizer
+  boolean_matcher::basic_matcher<boolean_matcher::cjk_tokenizer> m2("東京 NEAR/2 大学");
+  REQUIRE(m2.match("我在東京大学工作") == true);
+  REQUIRE(m2.match("東京的新大学") == false);
+  REQUIRE(m2.match("東 京 大学") == false);
+
+  REQUIRE_THROWS(boolean_matcher::basic_matcher<boolean_matcher::cjk_tokenizer>("AND"));
+  // katakana and latin words end at hiragana and ideographs
+  boolean_matcher::basic_matcher<boolean_matcher::cjk_tokenizer> m4("カメラ AND apple");
+  REQUIRE(m4.match("このカメラはapple製です") == true);
+  REQUIRE(m4.match("このカメラはapples製です") == false);
+  boolean_matcher::matcher m5("カメラ AND apple");
+  REQUIRE(m5.match("このカメラはapple製です") == false);
+
+  // a saved query can only be loaded with the same tokenizer
+  auto filename = "boolean_search_tokenizer_test.query";
+  m2.get_query()->save(filename);
+  REQUIRE(boolean_matcher::basic_compiled_query<boolean_matcher::cjk_tokenizer>::load(filename)->size() == 1);
+  REQUIRE_THROWS(boolean_matcher::compiled_query::load(filename));
+  std::remove(filename);
+}
+
+TEST_CASE( "metadata predicates", "[metadata]" ) {
+  boolean_matcher::metadata fi = { { "lang", "fi" }, { "timestamp", "2024-10-15" }, { "size", 120.0 } };
+  boolean_matcher::metadata en = { { "lang", "en" }, { "timestamp", "2024-09-01" }, { "size", 80.0 } };
+
+  boolean_matcher::matcher m(".lang = fi AND .timestamp > \"2024-10-01\" AND omena");
+  REQUIRE(m.match("omena ja päärynä", fi) == true);
+  REQUIRE(m.match("päärynä", fi) == false);
+  REQUIRE(m.match("omena ja päärynä", en) == false);
+  // a missing field is false
+  REQUIRE(m.match("omena ja päärynä") == false);
+  REQUIRE(m.match("omena", { { "lang", "fi" } }) == false);
+
+  // numbers and strings are compared by type
+  boolean_matcher::matcher m2(".size>=100 OR apple");
+  REQUIRE(m2.match("orange", fi) == true);
+  REQUIRE(m2.match("orange", en) == false);
+  REQUIRE(m2.match("an apple", en) == true);
+  REQUIRE(m2.match("orange", { { "size", "120" } }) == false);
+  boolean_matcher::matcher m3("apple NOT .lang != en");
+  REQUIRE(m3.match("apple", en) == true);
+  REQUIRE(m3.match("apple", fi) == false);
+  REQUIRE(boolean_matcher::matcher(".lang = \"fi\"").match("", fi) == true);
+  REQUIRE(boolean_matcher::matcher(".net AND asp").match("asp", { { "net", 1.0 } }) == false);
+
+  // a predicate has no matches but does not empty an AND
+  auto result = m.search("omena ja päärynä", fi);
+  REQUIRE(result.has_match());
+  REQUIRE(result.get_hit_sentence() == "omena ja päärynä");
+  REQUIRE(!m.search("omena ja päärynä", en).has_match());
+
+  // a predicate alone matches without matches in the text
+  boolean_matcher::matcher m4(".lang = fi");
+  REQUIRE(m4.search("omena", fi).has_match());
+  REQUIRE(m4.search("omena", fi).get_matches().empty());
+  REQUIRE(!m4.search("omena", en).has_match());
+
+  // the text is not scanned when the predicates decide the outcome
+  if (boolean_matcher::PROFILING) {
+    REQUIRE(m.get_statistics().bytes_ == 19 + 10 + 19);
+  }
+
+  m.begin(fi);
+  m.feed("omena");
+  REQUIRE(m.finish() == true);
+  m.begin(en);
+  m.feed("omena");
+  REQUIRE(m.finish() == false);
+
+  boolean_matcher::matcher_set s;
+  s.add(".lang = en");
+  s.add("apple AND .lang = fi");
+  s.add("apple");
+  s.add(".size < 100 NOT orange");
+  REQUIRE(s.match("apple", fi) == std::vector<size_t>({ 1, 2 }));
+  REQUIRE(s.match("orange", en) == std::vector<size_t>({ 0 }));
+  REQUIRE(s.match("pear", en) == std::vector<size_t>({ 0, 3 }));
+  REQUIRE(s.match("apple") == std::vector<size_t>({ 2 }));
+
+  std::vector<std::string> texts = { "omena", "omena", "päärynä" };
+  std::vector<boolean_matcher::metadata> records = { fi, en, fi };
+  boolean_matcher::thread_pool pool(2);
+  REQUIRE(m.match_batch(texts, records, pool) == std::vector<bool>({ true, false, false }));
+
+  // predicates are saved with the query
+  auto filename = "boolean_search_metadata_test.query";
+  s.get_query()->save(filename);
+  auto loaded = boolean_matcher::compiled_query::load(filename);
+  boolean_matcher::scan_context context;
+  REQUIRE(loaded->match_all("pear", en, context) == std::vector<size_t>({ 0, 3 }));
+  std::remove(filename);
+
+  REQUIRE_THROWS(boolean_matcher::matcher(".lang = fi NEAR apple"));
+  REQUIRE_THROWS(boolean_matcher::matcher(".lang = \"fi"));
+  REQUIRE_THROWS(boolean_matcher::matcher(".lang ="));
+}
+
+TEST_CASE( "query optimization", "[optimize]" ) {
+  // chains are flattened and duplicate operands are removed
+  boolean_matcher::matcher m("apple orange apple (pear OR orange)");
+  auto profile = m.profile(std::vector<std::string>({ "an orange" }));
+  REQUIRE(profile.size() == 4);
+  REQUIRE(profile[0].expression_ == "( apple OR orange OR pear)");
+  REQUIRE(profile[0].hits_ == 1);
+
+  // identical terms share a pattern
+  boolean_matcher::matcher m2("(apple AND pear) OR (apple AND plum)");
+  REQUIRE(m2.get_query()->get_state_count() == boolean_matcher::matcher("apple AND pear OR plum").get_query()->get_state_count());
+  REQUIRE(m2.match("plum apple") == true);
+  REQUIRE(m2.match("apple") == false);
+  REQUIRE(m2.search("apple and plum").get_hit_sentence() == "apple and plum");
+
+  // a bare wildcard is true
+  REQUIRE(boolean_matcher::matcher("*").match("") == true);
+  REQUIRE(boolean_matcher::matcher("**").match("!!!") == true);
+  REQUIRE(boolean_matcher::matcher("apple OR *").match("pear") == true);
+  REQUIRE(boolean_matcher::matcher("apple OR *").search("pear").has_match());
+  REQUIRE(!boolean_matcher::matcher("apple NOT *").search("apple").has_match());
+  REQUIRE(boolean_matcher::matcher("apple AND *").match("pear") == false);
+  REQUIRE(boolean_matcher::matcher("apple NOT *").match("apple") == false);
+  REQUIRE(boolean_matcher::matcher("(apple NOT *) OR pear").match("pear") == true);
+  boolean_matcher::matcher_set s;
+  s.add("apple");
+  s.add("* NOT pear");
+  REQUIRE(s.match("") == std::vector<size_t>({ 1 }));
+  REQUIRE(s.match("apple pear") == std::vector<size_t>({ 0 }));
+
+  // the operands are ordered by their rates in a sample
+  boolean_matcher::compiled_query q({ "common AND rare", "rare OR common", "(x NEAR y) AND .lang = fi AND common" });
+  std::vector<std::string> sample = { "common", "common rare", "common", "x y" };
+  q.optimize(sample);
+  boolean_matcher::scan_context context;
+  REQUIRE(q.profile(sample, 0)[0].expression_ == "( rare AND common)");
+  REQUIRE(q.profile(sample, 1)[0].expression_ == "( common OR rare)");
+  REQUIRE(q.profile(sample, 2)[0].expression_ == "( .lang = \"fi\" AND common AND ( x NEAR y))");
+  REQUIRE(q.match_all("common rare", context) == std::vector<size_t>({ 0, 1 }));
+  REQUIRE(q.match_all("x y common", { { "lang", "fi" } }, context) == std::vector<size_t>({ 1, 2 }));
+
+  // constants are saved with the query
+  auto filename = "boolean_search_optimize_test.query";
+  boolean_matcher::compiled_query({ "* NOT pear", "apple NOT *" }).save(filename);
+  auto loaded = boolean_matcher::compiled_query::load(filename);
+  REQUIRE(loaded->match_all("apple", context) == std::vector<size_t>({ 0 }));
+  REQUIRE(loaded->match_all("pear", context) == std::vector<size_t>());
+
+  // an optimized query keeps its results when it is saved and loaded
+  auto optimized = std::make_shared<boolean_matcher::compiled_query>("(alpha OR beta) AND (gamma NOT delta)");
+  optimized->optimize(std::vector<std::string>({ "beta gamma", "beta", "gamma", "delta" }));
+  optimized->save(filename);
+  boolean_matcher::matcher before(optimized), after(boolean_matcher::compiled_query::load(filename));
+  for (auto text : { "beta gamma", "delta alpha", "alpha gamma", "gamma beta delta", "alpha beta" }) {
+    REQUIRE(after.match(text) == before.match(text));
+    REQUIRE(after.search(text).get_hit_sentence() == before.search(text).get_hit_sentence());
+  }
+  REQUIRE(after.match("beta gamma") == true);
+  REQUIRE(after.match("delta alpha") == false);
+  REQUIRE(after.search("gamma and beta").get_hit_sentence() == "gamma and beta");
+  std::remove(filename);
+}
+
+TEST_CASE( "search offsets", "[search]" ) {
+  // the matches are byte offsets into the text that was passed in
+  boolean_matcher::matcher m("apple OR café OR дом OR *ing");
+  std::string text = "An APPLE,\r\n\x01" "Cafe\xcc\x81 and \tДОМ. Singing";
+  auto r = m.search(text);
+  auto & matches = r.get_matches();
+  REQUIRE(matches.size() == 4);
+  std::vector<std::string> found;
+  for (auto & match : matches) found.push_back(text.substr(static_cast<size_t>(match.pos_), static_cast<size_t>(match.size_)));
+  REQUIRE(found == std::vector<std::string>({ "APPLE", "Cafe\xcc\x81", "ДОМ", "ing" }));
+  REQUIRE(r.get_hit_sentence() == "An APPLE,\r\n\x01" "Cafe\xcc\x81 …");
+
+  // a result only refers to the text
+  REQUIRE(m.search("no hits here").get_matches().empty());
+  REQUIRE(boolean_matcher::compiled_query::result().get_hit_sentence() == "");
+}
+
+namespace {
+  constexpr char SPAM[] = "viagra OR (cheap AND pills) NOT \"pills review\"";
+  constexpr char FRUITS[] = "(apple* OR *berry OR \"päärynä\") NOT banana OR a b c d e f g";
+  constexpr char ANYTHING[] = "* OR nothing";
+}
+
+TEST_CASE( "static matchers", "[static]" ) {
+  // the tables are built during compilation
+  static_assert(boolean_matcher::static_matcher<SPAM>::get_term_count() == 4);
+  static_assert(boolean_matcher::static_matcher<FRUITS>::get_term_count() == 11);
+
+  boolean_matcher::static_matcher<SPAM> spam;
+  REQUIRE(spam.match("Buy VIAGRA now") == true);
+  REQUIRE(spam.match("cheap pills") == true);
+  REQUIRE(spam.match("\"cheap pills\"") == true);
+  REQUIRE(spam.match("Cheap\r\npills") == true);
+  REQUIRE(spam.match("cheap") == false);
+  REQUIRE(spam.match("Cheap pills review") == false);
+  REQUIRE(spam.match("cheappills") == false);
+
+  // the results are the same as with a runtime matcher
+  boolean_matcher::static_matcher<FRUITS> fruits;
+  boolean_matcher::matcher m(FRUITS);
+  for (auto text : { "Apples and bananas", "APPLES", "strawberry", "Päärynä", "PÄÄRYNÄ!", "g", "x  y", "Raspberry pie with a banana",
+		     "a long text without any of the words and with more than sixteen bytes, ending in a Blueberry" }) {
+    REQUIRE(fruits.match(text) == m.match(text));
+  }
+  REQUIRE(fruits.match("PÄÄRYNÄ!") == true);
+
+  boolean_matcher::static_matcher<ANYTHING> anything;
+  REQUIRE(anything.match("") == true);
+}
+
+TEST_CASE( "wide and normalized input", "[input]" ) {
+  boolean_matcher::matcher m("päärynä AND (\"big apple\" OR 𝒜*)");
+  REQUIRE(m.match(u"PÄÄRYNÄ and a Big\r\nApple") == true);
+  REQUIRE(m.match(U"Päärynä 𝒜BC") == true);
+  REQUIRE(m.match(L"päärynä and an apple") == false);
+  // an unpaired surrogate is replaced
+  REQUIRE(m.match(std::u16string(u"päärynä big apple") + char16_t(0xd800)) == true);
+
+  // normalized text is scanned as it is
+  REQUIRE(m.match_normalized("päärynä, big apple") == true);
+  REQUIRE(m.match_normalized(u"päärynä 𝒜bc") == true);
+  // the text is not case folded
+  REQUIRE(m.match_normalized(U"PÄÄRYNÄ big apple") == false);
+  REQUIRE(m.match_normalized(L"päärynä big apple") == true);
+
+  auto r = m.search_normalized("a big apple and päärynä");
+  REQUIRE(r.get_matches().size() == 2);
+  REQUIRE(r.get_matches()[0].pos_ == 16);
+  REQUIRE(r.get_matches()[0].size_ == 10);
+  REQUIRE(r.get_matches()[1].pos_ == 2);
+  REQUIRE(r.get_matches()[1].size_ == 9);
+
+  // long texts skip ASCII blocks of code units
+  std::u16string text(1000, u'x');
+  REQUIRE(m.match(text + u" päärynä big apple") == true);
+  REQUIRE(m.match_normalized(text + u" päärynä big apple") == true);
+  REQUIRE(m.match_normalized(text + u" päärynä big apples") == false);
+}
+
+TEST_CASE( "parallel scanning", "[batch]" ) {
+  boolean_matcher::thread_pool pool(4);
+  boolean_matcher::scan_context context;
+  auto getMatches = [](const boolean_matcher::compiled_query::result & r) {
+    std::vector<std::tuple<int, int, int>> matches;
+    for (auto & match : r.get_matches()) matches.emplace_back(match.pos_, match.size_, match.word_index_);
+    return matches;
+  };
+
+  std::string text;
+  const char * words[] = { "Apple", "orange", "colour", "Päärynä", "e\xcc\x81", "東京", "--", "\r\n", "hello world", "\x01" };
+  for (size_t i = 0; i < 2000; i++) {
+    text += words[(i * 7 + i / 13) % 10];
+    text += i % 5 ? " " : ", ";
+  }
+
+  // chunks of a few bytes split words and patterns, and the matches are still
+  // the same as with a sequential scan
+  for (auto expression : { "apple", "colo*r", "apple NEAR/1 orange", "\"hello world\" NOT päärynä", "*ange", "é", "東京", "a*e NEAR ora*" }) {
+    boolean_matcher::compiled_query query(expression);
+    auto expected = query.search(text, context);
+    for (size_t chunk_size : std::initializer_list<size_t>{ 1, 7, 64, 1000 }) {
+      REQUIRE(query.match(text, context, pool, chunk_size) == query.match(text, context));
+      REQUIRE(getMatches(query.search(text, context, pool, chunk_size)) == getMatches(expected));
+    }
+  }
+
+  boolean_matcher::matcher m("orange AND \"hello world\"");
+  REQUIRE(m.match(text, pool) == true);
+  REQUIRE(m.search(text, pool).get_matches().size() == m.search(text).get_matches().size());
+  REQUIRE(m.match("no match", pool) == false);
+}
+
+TEST_CASE( "document index", "[index]" ) {
+  std::vector<std::string> texts = { "The quick brown fox", "A fox, quick and brown", "quickly foxes", "Lazy dog.",
+				     "the brown-fox jumps over the lazy dog", "", "東京都の天気", "FOX" };
+  boolean_matcher::document_index index;
+  for (auto & text : texts) index.add(text);
+  REQUIRE(index.size() == texts.size());
+
+  // the results are the same as with match() on each document
+  for (auto expression : { "fox", "fox*", "quick NOT brown", "\"brown fox\"", "fox NEAR/1 brown", "brown ONEAR fox", "*fox*",
+			   "q*k AND (dog OR brown)", "lazy dog NOT \"brown-fox\"", "*", "* NOT fox", "京都", "fox NEAR (quick* OR lazy)" }) {
+    boolean_matcher::matcher m(expression);
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < texts.size(); i++) {
+      if (m.match(texts[i])) expected.push_back(i);
+    }
+    REQUIRE(index.search(expression) == expected);
+  }
+  REQUIRE(index.search("fox") == std::vector<size_t>({ 0, 1, 4, 7 }));
+
+  REQUIRE_THROWS(index.search("fox AND .year > 2000"));
+}
+
+TEST_CASE( "result cache", "[cache]" ) {
+  boolean_matcher::result_cache cache;
+  boolean_matcher::matcher m("apple AND orange");
+  REQUIRE(m.match("an apple and an orange", cache) == true);
+  REQUIRE(m.match("an apple and an orange", cache) == true);
+  REQUIRE(m.match("an apple", cache) == false);
+  REQUIRE(m.match("an apple", cache) == false);
+  auto statistics = cache.get_statistics();
+  REQUIRE(statistics.hits_ == 2);
+  REQUIRE(statistics.misses_ == 2);
+  REQUIRE(statistics.entries_ == 2);
+  REQUIRE(statistics.get_hit_rate() == 0.5);
+
+  // the matches of a cached search refer to the new text
+  std::string text = "An apple and an orange";
+  auto r1 = m.search(text, cache);
+  std::string copy = text;
+  auto r2 = m.search(copy, cache);
+  REQUIRE(cache.get_statistics().hits_ == 3);
+  REQUIRE(r2.get_matches().size() == 2);
+  REQUIRE(r2.get_matches()[0].pos_ == r1.get_matches()[0].pos_);
+  REQUIRE(r2.get_hit_sentence() == r1.get_hit_sentence());
+  // a search also stores the outcome for match()
+  REQUIRE(m.match(text, cache) == true);
+  REQUIRE(cache.get_statistics().hits_ == 4);
+  REQUIRE(m.search("an orange", cache).has_match() == false);
+  REQUIRE(m.match("an orange", cache) == false);
+  REQUIRE(cache.get_statistics().hits_ == 5);
+
+  // another query does not see the results
+  boolean_matcher::matcher m2("apple NOT orange");
+  REQUIRE(m2.match("an apple and an orange", cache) == false);
+  REQUIRE(cache.get_statistics().misses_ == 5);
+
+  // queries that share a cache keep their own results for the same texts
+  boolean_matcher::result_cache shared_cache;
+  boolean_matcher::matcher foo("foo"), bar("bar");
+  for (int i = 0; i < 10; i++) {
+    for (auto text : { "foo", "bar", "foo bar", "baz" }) {
+      REQUIRE(foo.match(text, shared_cache) == (std::string_view(text).find("foo") != std::string_view::npos));
+      REQUIRE(bar.match(text, shared_cache) == (std::string_view(text).find("bar") != std::string_view::npos));
+    }
+  }
+  REQUIRE(shared_cache.get_statistics().entries_ == 8);
+  REQUIRE(shared_cache.get_statistics().get_hit_rate() == 0.9);
+
+  // entries are evicted to stay within the memory budget
+  boolean_matcher::result_cache small_cache(4096, 1);
+  int found = 0;
+  for (int i = 0; i < 1000; i++) found += m.match("apple " + std::to_string(i) + " orange", small_cache);
+  REQUIRE(found == 1000);
+  statistics = small_cache.get_statistics();
+  REQUIRE(statistics.evictions_ > 0);
+  REQUIRE(statistics.bytes_ <= 4096);
+  small_cache.clear();
+  REQUIRE(small_cache.get_statistics().entries_ == 0);
+
+  std::vector<std::string> texts;
+  for (int i = 0; i < 1000; i++) texts.push_back(i % 3 ? "apple and orange" : "apple " + std::to_string(i % 7));
+  boolean_matcher::thread_pool pool(4);
+  REQUIRE(m.match_batch(texts, pool, cache) == m.match_batch(texts, pool));
+  REQUIRE(cache.get_statistics().entries_ == 13);
+}